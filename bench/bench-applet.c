@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#include "bench-applet.h"
+#include "task-list.h"
+#include "task-strip.h"
+
+#define SETTINGS_SCHEMA "org.gnome.gnome-applets.window-picker-applet"
+
+/* The same getters as applet.c, backed by plain fields */
+struct _WindowPickerAppletPrivate {
+    GtkWidget *tasks;
+    GSettings *settings;
+    gboolean show_all_windows;
+    gboolean icons_greyscale;
+};
+
+enum {
+    PROP_0,
+    PROP_SHOW_ALL_WINDOWS,
+    PROP_ICONS_GREYSCALE,
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (WindowPickerApplet, window_picker_applet, PANEL_TYPE_APPLET);
+
+static void window_picker_applet_get_property (GObject *object,
+    guint prop_id,
+    GValue *value,
+    GParamSpec *pspec)
+{
+    WindowPickerApplet *picker = WINDOW_PICKER_APPLET (object);
+    switch (prop_id) {
+        case PROP_SHOW_ALL_WINDOWS:
+            g_value_set_boolean (value, picker->priv->show_all_windows);
+            break;
+        case PROP_ICONS_GREYSCALE:
+            g_value_set_boolean (value, picker->priv->icons_greyscale);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void window_picker_applet_set_property (GObject *object,
+    guint prop_id,
+    const GValue *value,
+    GParamSpec *pspec)
+{
+    WindowPickerApplet *picker = WINDOW_PICKER_APPLET (object);
+    switch (prop_id) {
+        case PROP_SHOW_ALL_WINDOWS:
+            picker->priv->show_all_windows = g_value_get_boolean (value);
+            break;
+        case PROP_ICONS_GREYSCALE:
+            picker->priv->icons_greyscale = g_value_get_boolean (value);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void window_picker_applet_finalize (GObject *object) {
+    g_clear_object (&WINDOW_PICKER_APPLET (object)->priv->settings);
+    G_OBJECT_CLASS (window_picker_applet_parent_class)->finalize (object);
+}
+
+static void window_picker_applet_class_init (WindowPickerAppletClass *klass) {
+    GObjectClass *obj_class = G_OBJECT_CLASS (klass);
+    obj_class->get_property = window_picker_applet_get_property;
+    obj_class->set_property = window_picker_applet_set_property;
+    obj_class->finalize = window_picker_applet_finalize;
+    g_object_class_install_property (obj_class, PROP_SHOW_ALL_WINDOWS,
+        g_param_spec_boolean ("show-all-windows", "Show All Windows",
+            "Show windows from all workspaces", FALSE, G_PARAM_READWRITE));
+    g_object_class_install_property (obj_class, PROP_ICONS_GREYSCALE,
+        g_param_spec_boolean ("icons-greyscale", "Icons Greyscale",
+            "All icons except the current active window icon are greyed out",
+            TRUE, G_PARAM_READWRITE));
+}
+
+static void window_picker_applet_init (WindowPickerApplet *picker) {
+    picker->priv = window_picker_applet_get_instance_private (picker);
+    picker->priv->show_all_windows = FALSE;
+    picker->priv->icons_greyscale = TRUE;
+}
+
+WindowPickerApplet *bench_applet_new (gboolean single_widget_renderer) {
+    WindowPickerApplet *picker = g_object_new (WINDOW_PICKER_APPLET_TYPE, NULL);
+    picker->priv->settings = g_settings_new (SETTINGS_SCHEMA);
+    if (single_widget_renderer) {
+        picker->priv->tasks = task_strip_new (picker);
+    } else {
+        picker->priv->tasks = task_list_new (picker);
+    }
+    gtk_container_add (GTK_CONTAINER (picker), picker->priv->tasks);
+    return picker;
+}
+
+GSettings *window_picker_applet_get_settings (WindowPickerApplet *picker) {
+    return picker->priv->settings;
+}
+
+GtkWidget *window_picker_applet_get_tasks (WindowPickerApplet *picker) {
+    return picker->priv->tasks;
+}
+
+gboolean window_picker_applet_get_desktop_visible (WindowPickerApplet *picker) {
+    if (TASK_IS_STRIP (picker->priv->tasks))
+        return task_strip_get_desktop_visible (TASK_STRIP (picker->priv->tasks));
+    return task_list_get_desktop_visible (TASK_LIST (picker->priv->tasks));
+}
+
+gboolean window_picker_applet_get_show_all_windows (WindowPickerApplet *picker) {
+    return picker->priv->show_all_windows;
+}
+
+gboolean window_picker_applet_get_show_application_title (WindowPickerApplet *picker) {
+    return FALSE;
+}
+
+gboolean window_picker_applet_get_show_home_title (WindowPickerApplet *picker) {
+    return FALSE;
+}
+
+gboolean window_picker_applet_get_icons_greyscale (WindowPickerApplet *picker) {
+    return picker->priv->icons_greyscale;
+}
+
+gboolean window_picker_applet_get_expand_task_list (WindowPickerApplet *picker) {
+    return FALSE;
+}
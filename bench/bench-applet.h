@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#ifndef _BENCH_APPLET_H_
+#define _BENCH_APPLET_H_
+
+#include "applet.h"
+
+G_BEGIN_DECLS
+
+/**
+ * Creates a WindowPickerApplet with either renderer of the task list and
+ * without the title, the panel menu and the preferences of the real applet.
+ * Windows of other workspaces are hidden, so workspace switches change what
+ * is shown.
+ */
+WindowPickerApplet *bench_applet_new (gboolean single_widget_renderer);
+
+G_END_DECLS
+
+#endif /* _BENCH_APPLET_H_ */
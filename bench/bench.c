@@ -0,0 +1,572 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+/**
+ * Headless benchmark of the task list. The task list and the single widget
+ * renderer are driven by synthetic workloads on a mock libwnck screen, and
+ * the latency and the heap allocations of every operation are reported for
+ * a number of window counts. Run it with: make bench
+ */
+
+#include "bench-applet.h"
+#include "mock-alloc.h"
+#include "mock-wnck.h"
+#include "task-debug.h"
+#include "task-icon-cache.h"
+#include "task-icon-store.h"
+#include "task-list.h"
+#include "task-strip.h"
+
+#include <stdlib.h>
+#include <glib/gstdio.h>
+
+#define N_WORKSPACES 4
+#define N_APPLICATIONS 24
+#define THEMED_EVERY 3 /* every 3rd application has an icon in the icon theme */
+#define VIEWPORT_COLUMNS 2 /* the last workspace is a virtual one of 2x2 viewports */
+#define VIEWPORT_ROWS 2
+#define PINNED_EVERY 20 /* every 20th window is on all workspaces */
+#define MINIMIZED_EVERY 7 /* every 7th window starts minimized */
+#define PANEL_LENGTH 1600
+#define PANEL_HEIGHT 32
+#define ICON_SIZE 48
+#define FLUSH_LIMIT 100000
+#define DRAG_MOTIONS 10 /* the items that a drag crosses */
+
+static const guint default_window_counts[] = { 50, 200, 1000, 3000 };
+
+typedef struct {
+    const gchar *name;
+    guint   runs;
+    gint64  total; /* in microseconds */
+    gint64  max;   /* in microseconds */
+    guint64 allocations;
+    gint64  bytes; /* heap growth, memory that was freed counts negative */
+} BenchOp;
+
+typedef struct {
+    gint64         time;
+    MockAllocStats alloc;
+} BenchMark;
+
+typedef struct {
+    gboolean            strip;
+    guint               n_windows;
+    GRand              *rand;
+    GPtrArray          *windows; /* the open windows */
+    GdkPixbuf          *icons[N_APPLICATIONS];
+    GdkPixbuf          *changed_icons[N_APPLICATIONS];
+    gchar              *icon_names[N_APPLICATIONS];
+    GtkWidget          *toplevel;
+    WindowPickerApplet *applet;
+    guint               next_window;
+} Bench;
+
+static void bench_mark (BenchMark *mark) {
+    mock_alloc_get_stats (&mark->alloc);
+    mark->time = g_get_monotonic_time ();
+}
+
+static void bench_op_add (BenchOp *op, BenchMark *start) {
+    BenchMark end;
+    gint64 elapsed;
+    end.time = g_get_monotonic_time ();
+    mock_alloc_get_stats (&end.alloc);
+    elapsed = end.time - start->time;
+    op->runs++;
+    op->total += elapsed;
+    op->max = MAX (op->max, elapsed);
+    op->allocations += end.alloc.allocations - start->alloc.allocations;
+    op->bytes += end.alloc.live_bytes - start->alloc.live_bytes;
+}
+
+static void bench_op_print (Bench *bench, BenchOp *op) {
+    if (op->runs == 0)
+        return;
+    g_print ("%-6s %7u  %-20s %5u %10.1f %9" G_GINT64_FORMAT " %10.1f %11.1f\n",
+        bench->strip ? "strip" : "list", bench->n_windows, op->name, op->runs,
+        (gdouble) op->total / op->runs, op->max,
+        (gdouble) op->allocations / op->runs, (gdouble) op->bytes / op->runs);
+}
+
+/**
+ * Runs everything the operation left for the main loop, like the visibility
+ * pass and the population batches, then lays out and paints the damaged part
+ * of the offscreen panel.
+ */
+static void bench_flush (Bench *bench) {
+    guint i;
+    for (i = 0; i < FLUSH_LIMIT && g_main_context_pending (NULL); i++)
+        g_main_context_iteration (NULL, FALSE);
+    gtk_container_check_resize (GTK_CONTAINER (bench->toplevel));
+    gdk_window_process_updates (gtk_widget_get_window (bench->toplevel), TRUE);
+}
+
+static GdkPixbuf *bench_create_icon (guint32 color) {
+    GdkPixbuf *icon = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, ICON_SIZE, ICON_SIZE);
+    gdk_pixbuf_fill (icon, color);
+    return icon;
+}
+
+static WnckWindow *bench_create_window (Bench *bench) {
+    guint index = bench->next_window++;
+    guint application = index % N_APPLICATIONS;
+    gchar *name = g_strdup_printf ("Window %u", index);
+    gchar *class_name = g_strdup_printf ("application-%u", application);
+    WnckWorkspace *workspace = index % PINNED_EVERY == 0 ? NULL
+        : mock_wnck_screen_get_workspace (index % N_WORKSPACES);
+    WnckWindow *window = mock_wnck_window_new (name, class_name, workspace,
+        bench->icons[application]);
+    mock_wnck_window_set_icon_name (window, bench->icon_names[application]);
+    if (workspace && wnck_workspace_is_virtual (workspace)) {
+        guint viewport = index / N_WORKSPACES;
+        mock_wnck_window_move_to_viewport (window, viewport % VIEWPORT_COLUMNS,
+            viewport / VIEWPORT_COLUMNS % VIEWPORT_ROWS);
+    }
+    g_ptr_array_add (bench->windows, window);
+    g_free (class_name);
+    g_free (name);
+    return window;
+}
+
+static WnckWindow *bench_random_window (Bench *bench) {
+    return g_ptr_array_index (bench->windows,
+        g_rand_int_range (bench->rand, 0, bench->windows->len));
+}
+
+/* Returns a random window that is shown on the active workspace */
+static WnckWindow *bench_random_shown_window (Bench *bench) {
+    WnckWorkspace *workspace = wnck_screen_get_active_workspace (wnck_screen_get_default ());
+    guint i;
+    for (i = 0; i < 1000; i++) {
+        WnckWindow *window = bench_random_window (bench);
+        if (wnck_window_is_on_workspace (window, workspace))
+            return window;
+    }
+    return bench_random_window (bench);
+}
+
+static TaskItem *bench_find_item (GtkWidget *tasks, WnckWindow *window) {
+    GList *children = gtk_container_get_children (GTK_CONTAINER (tasks));
+    GList *l;
+    TaskItem *item = NULL;
+    for (l = children; l && !item; l = l->next) {
+        if (task_item_get_window (l->data) == window)
+            item = l->data;
+    }
+    g_list_free (children);
+    return item;
+}
+
+/* Shows the applet in an offscreen panel and paints it once */
+static void bench_start (Bench *bench) {
+    bench->applet = bench_applet_new (bench->strip);
+    bench->toplevel = gtk_offscreen_window_new ();
+    gtk_widget_set_size_request (GTK_WIDGET (bench->applet), PANEL_LENGTH, PANEL_HEIGHT);
+    gtk_container_add (GTK_CONTAINER (bench->toplevel), GTK_WIDGET (bench->applet));
+    gtk_widget_show_all (bench->toplevel);
+    bench_flush (bench);
+}
+
+/* Waits until the icons that are scaled in worker threads are loaded */
+static void bench_wait_for_icons (Bench *bench) {
+    guint i;
+    for (i = 0; i < 5000 && task_icon_cache_get_n_loading () > 0; i++) {
+        g_usleep (1000);
+        bench_flush (bench);
+    }
+    bench_flush (bench);
+}
+
+/* Destroys the applet and drops the icons from memory, like a restart */
+static void bench_stop (Bench *bench) {
+    guint i;
+    gtk_widget_destroy (bench->toplevel);
+    for (i = 0; i < FLUSH_LIMIT && g_main_context_pending (NULL); i++)
+        g_main_context_iteration (NULL, FALSE);
+    task_icon_cache_clear ();
+    bench->toplevel = NULL;
+    bench->applet = NULL;
+}
+
+static void bench_run (Bench *bench) {
+    BenchOp cold_startup = { "startup cold store" };
+    BenchOp cold_icons = { "icons cold store" };
+    BenchOp warm_startup = { "startup warm store" };
+    BenchOp warm_icons = { "icons warm store" };
+    BenchOp repaint = { "full repaint" };
+    BenchOp focus = { "focus change" };
+    BenchOp storm = { "focus storm x100" };
+    BenchOp workspace = { "workspace switch" };
+    BenchOp viewport = { "viewport switch" };
+    BenchOp icon = { "icon change" };
+    BenchOp urgency = { "urgency flag" };
+    BenchOp reorder = { "dnd reorder" };
+    BenchOp drag = { "dnd drag" };
+    guint64 drag_x_requests = 0;
+    BenchOp close = { "window close" };
+    BenchOp open = { "window open" };
+    guint n_churn = MAX (bench->n_windows / 10, 10);
+    guint64 icon_geometry_requests = mock_wnck_get_icon_geometry_requests ();
+    MockAllocStats before, after;
+    BenchMark mark;
+    guint i, j;
+
+    mock_wnck_screen_reset (N_WORKSPACES);
+    mock_wnck_workspace_set_viewports (mock_wnck_screen_get_workspace (N_WORKSPACES - 1),
+        VIEWPORT_COLUMNS, VIEWPORT_ROWS);
+    bench->windows = g_ptr_array_new ();
+    bench->next_window = 0;
+    for (i = 0; i < bench->n_windows; i++) {
+        WnckWindow *window = bench_create_window (bench);
+        if (i % MINIMIZED_EVERY == MINIMIZED_EVERY - 1) {
+            mock_wnck_window_set_state (window, WNCK_WINDOW_STATE_MINIMIZED,
+                WNCK_WINDOW_STATE_MINIMIZED);
+        }
+    }
+    wnck_window_activate (g_ptr_array_index (bench->windows, 0), 0);
+
+    /* The first start finds an empty icon store and loads every icon, the
+     * second one finds the icons that the first one stored. Startup is
+     * measured until the first paint of the panel, the icons until the last
+     * placeholder is replaced. */
+    task_icon_cache_clear ();
+    task_icon_store_clear ();
+    task_icon_store_flush ();
+    mock_alloc_get_stats (&before);
+    bench_mark (&mark);
+    bench_start (bench);
+    bench_op_add (&cold_startup, &mark);
+    mock_alloc_get_stats (&after);
+    g_print ("%-6s %7u  heap per window after startup: %" G_GINT64_FORMAT " bytes",
+        bench->strip ? "strip" : "list", bench->n_windows,
+        (after.live_bytes - before.live_bytes) / bench->n_windows);
+    bench_wait_for_icons (bench);
+    bench_op_add (&cold_icons, &mark);
+    mock_alloc_get_stats (&after);
+    g_print (", with loaded icons: %" G_GINT64_FORMAT " bytes\n",
+        (after.live_bytes - before.live_bytes) / bench->n_windows);
+    task_icon_cache_flush ();
+    bench_stop (bench);
+
+    bench_mark (&mark);
+    bench_start (bench);
+    bench_op_add (&warm_startup, &mark);
+    bench_wait_for_icons (bench);
+    bench_op_add (&warm_icons, &mark);
+
+    for (i = 0; i < 20; i++) {
+        bench_mark (&mark);
+        gtk_widget_queue_draw (bench->toplevel);
+        bench_flush (bench);
+        bench_op_add (&repaint, &mark);
+    }
+    for (i = 0; i < 200; i++) {
+        WnckWindow *window = bench_random_shown_window (bench);
+        bench_mark (&mark);
+        wnck_window_activate (window, 0);
+        bench_flush (bench);
+        bench_op_add (&focus, &mark);
+    }
+    for (i = 0; i < 10; i++) {
+        bench_mark (&mark);
+        for (j = 0; j < 100; j++)
+            wnck_window_activate (bench_random_window (bench), 0);
+        bench_flush (bench);
+        bench_op_add (&storm, &mark);
+    }
+    for (i = 1; i <= 40; i++) {
+        WnckWorkspace *next = mock_wnck_screen_get_workspace (i % N_WORKSPACES);
+        bench_mark (&mark);
+        wnck_workspace_activate (next, 0);
+        bench_flush (bench);
+        bench_op_add (&workspace, &mark);
+    }
+    wnck_workspace_activate (mock_wnck_screen_get_workspace (N_WORKSPACES - 1), 0);
+    bench_flush (bench);
+    for (i = 1; i <= 40; i++) {
+        guint next = i % (VIEWPORT_COLUMNS * VIEWPORT_ROWS);
+        bench_mark (&mark);
+        mock_wnck_workspace_move_viewport (mock_wnck_screen_get_workspace (N_WORKSPACES - 1),
+            next % VIEWPORT_COLUMNS, next / VIEWPORT_COLUMNS);
+        bench_flush (bench);
+        bench_op_add (&viewport, &mark);
+    }
+    wnck_workspace_activate (mock_wnck_screen_get_workspace (0), 0);
+    bench_flush (bench);
+    for (i = 0; i < 100; i++) {
+        WnckWindow *window = bench_random_shown_window (bench);
+        guint application = g_rand_int_range (bench->rand, 0, N_APPLICATIONS);
+        bench_mark (&mark);
+        mock_wnck_window_set_icon (window, i % 2 ? bench->icons[application]
+                                                 : bench->changed_icons[application]);
+        bench_flush (bench);
+        bench_op_add (&icon, &mark);
+    }
+    for (i = 0; i < 100; i++) {
+        WnckWindow *window = bench_random_shown_window (bench);
+        bench_mark (&mark);
+        mock_wnck_window_set_state (window, WNCK_WINDOW_STATE_DEMANDS_ATTENTION,
+            WNCK_WINDOW_STATE_DEMANDS_ATTENTION);
+        bench_flush (bench);
+        bench_op_add (&urgency, &mark);
+        bench_mark (&mark);
+        mock_wnck_window_set_state (window, WNCK_WINDOW_STATE_DEMANDS_ATTENTION, 0);
+        bench_flush (bench);
+        bench_op_add (&urgency, &mark);
+    }
+    for (i = 0; i < 100; i++) {
+        WnckWindow *window = bench_random_shown_window (bench);
+        WnckWindow *target = bench_random_shown_window (bench);
+        /* looking up the items of the task list is not part of the reorder */
+        GtkWidget *tasks = window_picker_applet_get_tasks (bench->applet);
+        TaskItem *item = bench->strip ? NULL : bench_find_item (tasks, window);
+        TaskItem *target_item = bench->strip ? NULL : bench_find_item (tasks, target);
+        bench_mark (&mark);
+        if (bench->strip) {
+            task_strip_move_window (TASK_STRIP (tasks), window, target);
+        } else if (item && target_item && item != target_item) {
+            task_list_move_item (TASK_LIST (tasks), item, target_item);
+        }
+        bench_flush (bench);
+        bench_op_add (&reorder, &mark);
+    }
+#if GTK_CHECK_VERSION (3, 16, 0)
+    /* A drag of an item through GTK+ like the user does it, from drag-begin
+     * over the other items to the end of the drag. The single widget
+     * renderer only drags what was pressed with the mouse, so it is left out */
+    for (i = 0; i < 20 && !bench->strip; i++) {
+        GtkWidget *tasks = window_picker_applet_get_tasks (bench->applet);
+        TaskItem *item = bench_find_item (tasks, bench_random_shown_window (bench));
+        TaskItem *targets[DRAG_MOTIONS];
+        GdkDragContext *context;
+        guint64 x_requests;
+        for (j = 0; j < DRAG_MOTIONS; j++)
+            targets[j] = bench_find_item (tasks, bench_random_shown_window (bench));
+        if (item == NULL)
+            continue;
+        x_requests = task_debug_get_x_requests ();
+        bench_mark (&mark);
+        context = gtk_drag_begin_with_coordinates (GTK_WIDGET (item),
+            gtk_drag_source_get_target_list (GTK_WIDGET (item)),
+            GDK_ACTION_COPY, 1, NULL, -1, -1);
+        if (context == NULL) {
+            /* the pointer could not be grabbed */
+            bench_flush (bench);
+            continue;
+        }
+        for (j = 0; j < DRAG_MOTIONS; j++) {
+            gboolean handled;
+            if (targets[j] == NULL)
+                continue;
+            g_signal_emit_by_name (targets[j], "drag-motion", context, 1, 1,
+                GDK_CURRENT_TIME, &handled);
+            bench_flush (bench);
+        }
+        gtk_drag_cancel (context);
+        bench_flush (bench);
+        bench_op_add (&drag, &mark);
+        drag_x_requests += task_debug_get_x_requests () - x_requests;
+    }
+#endif
+    for (i = 0; i < n_churn && bench->windows->len > 1; i++) {
+        guint index = g_rand_int_range (bench->rand, 0, bench->windows->len);
+        WnckWindow *window = g_ptr_array_index (bench->windows, index);
+        g_ptr_array_remove_index_fast (bench->windows, index);
+        bench_mark (&mark);
+        mock_wnck_window_close (window);
+        bench_flush (bench);
+        bench_op_add (&close, &mark);
+    }
+    for (i = 0; i < n_churn; i++) {
+        WnckWindow *window = bench_create_window (bench);
+        bench_mark (&mark);
+        mock_wnck_window_open (window);
+        bench_flush (bench);
+        bench_op_add (&open, &mark);
+    }
+
+    bench_op_print (bench, &cold_startup);
+    bench_op_print (bench, &cold_icons);
+    bench_op_print (bench, &warm_startup);
+    bench_op_print (bench, &warm_icons);
+    bench_op_print (bench, &repaint);
+    bench_op_print (bench, &focus);
+    bench_op_print (bench, &storm);
+    bench_op_print (bench, &workspace);
+    bench_op_print (bench, &viewport);
+    bench_op_print (bench, &icon);
+    bench_op_print (bench, &urgency);
+    bench_op_print (bench, &reorder);
+    bench_op_print (bench, &drag);
+    bench_op_print (bench, &close);
+    bench_op_print (bench, &open);
+    g_print ("%-6s %7u  minimize hints sent: %" G_GUINT64_FORMAT "\n",
+        bench->strip ? "strip" : "list", bench->n_windows,
+        mock_wnck_get_icon_geometry_requests () - icon_geometry_requests);
+    if (drag.runs > 0) {
+        g_print ("%-6s %7u  X requests per drag of %u motions: %.1f\n",
+            bench->strip ? "strip" : "list", bench->n_windows, DRAG_MOTIONS,
+            (gdouble) drag_x_requests / drag.runs);
+    }
+
+    bench_stop (bench);
+    g_ptr_array_free (bench->windows, TRUE);
+    bench->windows = NULL;
+}
+
+/**
+ * Gives the applications icon names. The icons of every THEMED_EVERY-th
+ * application are written to icon_dir, which is added to the icon theme, so
+ * that they are loaded by the icon theme like the icons of real applications.
+ * The next application has an icon name that the theme does not have and
+ * falls back to its window icon.
+ */
+static void bench_install_icons (Bench *bench, const gchar *icon_dir) {
+    guint i;
+    if (icon_dir == NULL || g_mkdir_with_parents (icon_dir, 0700) != 0)
+        return;
+    for (i = 0; i < N_APPLICATIONS; i++) {
+        if (i % THEMED_EVERY == 0) {
+            gchar *name = g_strdup_printf ("window-picker-bench-%u", i);
+            gchar *file = g_strdup_printf ("%s.png", name);
+            gchar *path = g_build_filename (icon_dir, file, NULL);
+            if (gdk_pixbuf_save (bench->icons[i], path, "png", NULL, NULL))
+                bench->icon_names[i] = g_strdup (name);
+            g_free (path);
+            g_free (file);
+            g_free (name);
+        } else if (i % THEMED_EVERY == 1) {
+            bench->icon_names[i] = g_strdup_printf ("window-picker-bench-missing-%u", i);
+        }
+    }
+    gtk_icon_theme_append_search_path (gtk_icon_theme_get_default (), icon_dir);
+}
+
+/* Removes the icon store and the icons that the runs wrote into the temporary cache */
+static void bench_remove_cache (const gchar *cache_dir) {
+    gchar *store_dir = g_build_filename (cache_dir, "window-picker-applet", NULL);
+    gchar *store = g_build_filename (store_dir, "icons.cache", NULL);
+    gchar *icon_dir = g_build_filename (cache_dir, "icons", NULL);
+    GDir *dir = g_dir_open (icon_dir, 0, NULL);
+    if (dir) {
+        const gchar *file;
+        while ((file = g_dir_read_name (dir))) {
+            gchar *path = g_build_filename (icon_dir, file, NULL);
+            g_remove (path);
+            g_free (path);
+        }
+        g_dir_close (dir);
+    }
+    g_rmdir (icon_dir);
+    g_remove (store);
+    g_rmdir (store_dir);
+    g_rmdir (cache_dir);
+    g_free (icon_dir);
+    g_free (store);
+    g_free (store_dir);
+}
+
+int main (int argc, char **argv) {
+    gchar *windows_option = NULL;
+    gchar *mode_option = NULL;
+    GOptionEntry entries[] = {
+        { "windows", 'w', 0, G_OPTION_ARG_STRING, &windows_option,
+          "Comma separated window counts, the default is 50,200,1000,3000", "N,..." },
+        { "mode", 'm', 0, G_OPTION_ARG_STRING, &mode_option,
+          "Measure the task list (list), the single widget renderer (strip) or both", "MODE" },
+        { NULL }
+    };
+    GArray *window_counts = g_array_new (FALSE, FALSE, sizeof (guint));
+    GError *error = NULL;
+    Bench bench = { 0, };
+    gchar *cache_dir;
+    guint i, mode;
+
+    /* the icon store of the runs must not touch the cache of the user */
+    cache_dir = g_dir_make_tmp ("window-picker-bench-XXXXXX", NULL);
+    if (cache_dir)
+        g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+    if (!gtk_init_with_args (&argc, &argv, NULL, entries, NULL, &error)) {
+        g_printerr ("window-picker-bench: %s\n",
+            error ? error->message : "cannot open a display, run it under xvfb-run");
+        if (cache_dir)
+            bench_remove_cache (cache_dir);
+        return 77;
+    }
+    if (windows_option) {
+        gchar **counts = g_strsplit (windows_option, ",", -1);
+        for (i = 0; counts[i]; i++) {
+            guint count = g_ascii_strtoull (counts[i], NULL, 10);
+            if (count > 0)
+                g_array_append_val (window_counts, count);
+        }
+        g_strfreev (counts);
+    } else {
+        g_array_append_vals (window_counts, default_window_counts,
+            G_N_ELEMENTS (default_window_counts));
+    }
+
+    bench.rand = g_rand_new_with_seed (1);
+    for (i = 0; i < N_APPLICATIONS; i++) {
+        bench.icons[i] = bench_create_icon (0x10305000 + i * 0x0a0400ff);
+        bench.changed_icons[i] = bench_create_icon (0xa0201000 + i * 0x000a04ff);
+    }
+    if (cache_dir) {
+        gchar *icon_dir = g_build_filename (cache_dir, "icons", NULL);
+        bench_install_icons (&bench, icon_dir);
+        g_free (icon_dir);
+    }
+
+    g_print ("window-picker-bench: %u workspaces (the last with %ux%u viewports), "
+        "%u applications (1 in %u with a themed icon), %ux%u panel, "
+        "1 in %u windows on all workspaces, 1 in %u minimized\n",
+        N_WORKSPACES, VIEWPORT_COLUMNS, VIEWPORT_ROWS, N_APPLICATIONS, THEMED_EVERY,
+        PANEL_LENGTH, PANEL_HEIGHT, PINNED_EVERY, MINIMIZED_EVERY);
+    if (!mock_alloc_available ())
+        g_print ("allocations are not counted, this needs glibc\n");
+    g_print ("%-6s %7s  %-20s %5s %10s %9s %10s %11s\n",
+        "mode", "windows", "operation", "runs", "mean us", "max us", "allocs/op", "bytes/op");
+    for (mode = 0; mode < 2; mode++) {
+        bench.strip = mode == 1;
+        if (mode_option && g_strcmp0 (mode_option, "both") != 0
+            && g_strcmp0 (mode_option, bench.strip ? "strip" : "list") != 0)
+        {
+            continue;
+        }
+        for (i = 0; i < window_counts->len; i++) {
+            bench.n_windows = g_array_index (window_counts, guint, i);
+            bench_run (&bench);
+        }
+    }
+
+    for (i = 0; i < N_APPLICATIONS; i++) {
+        g_object_unref (bench.icons[i]);
+        g_object_unref (bench.changed_icons[i]);
+        g_free (bench.icon_names[i]);
+    }
+    g_rand_free (bench.rand);
+    g_array_free (window_counts, TRUE);
+    if (cache_dir) {
+        bench_remove_cache (cache_dir);
+        g_free (cache_dir);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#include "mock-alloc.h"
+
+#ifdef __GLIBC__
+
+#include <malloc.h>
+#include <errno.h>
+
+/* The allocator of glibc under its internal names */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void *__libc_memalign (size_t alignment, size_t size);
+extern void  __libc_free (void *ptr);
+
+/* Icons are scaled in worker threads, so the counters are updated atomically */
+static guint64 n_allocations = 0;
+static gint64 live_bytes = 0;
+
+static void *count_allocation (void *ptr) {
+    if (ptr) {
+        __atomic_add_fetch (&n_allocations, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch (&live_bytes, (gint64) malloc_usable_size (ptr), __ATOMIC_RELAXED);
+    }
+    return ptr;
+}
+
+void *malloc (size_t size) {
+    return count_allocation (__libc_malloc (size));
+}
+
+void *calloc (size_t n, size_t size) {
+    return count_allocation (__libc_calloc (n, size));
+}
+
+void *realloc (void *ptr, size_t size) {
+    gint64 old_size = ptr ? (gint64) malloc_usable_size (ptr) : 0;
+    void *result = __libc_realloc (ptr, size);
+    if (result) {
+        __atomic_sub_fetch (&live_bytes, old_size, __ATOMIC_RELAXED);
+        count_allocation (result);
+    } else if (size == 0) {
+        /* realloc (ptr, 0) frees ptr */
+        __atomic_sub_fetch (&live_bytes, old_size, __ATOMIC_RELAXED);
+    }
+    return result;
+}
+
+void *memalign (size_t alignment, size_t size) {
+    return count_allocation (__libc_memalign (alignment, size));
+}
+
+void *aligned_alloc (size_t alignment, size_t size) {
+    return count_allocation (__libc_memalign (alignment, size));
+}
+
+int posix_memalign (void **ptr, size_t alignment, size_t size) {
+    void *result = __libc_memalign (alignment, size);
+    if (result == NULL)
+        return ENOMEM;
+    *ptr = count_allocation (result);
+    return 0;
+}
+
+void free (void *ptr) {
+    if (ptr)
+        __atomic_sub_fetch (&live_bytes, (gint64) malloc_usable_size (ptr), __ATOMIC_RELAXED);
+    __libc_free (ptr);
+}
+
+gboolean mock_alloc_available (void) {
+    return TRUE;
+}
+
+void mock_alloc_get_stats (MockAllocStats *stats) {
+    stats->allocations = __atomic_load_n (&n_allocations, __ATOMIC_RELAXED);
+    stats->live_bytes = __atomic_load_n (&live_bytes, __ATOMIC_RELAXED);
+}
+
+#else /* __GLIBC__ */
+
+gboolean mock_alloc_available (void) {
+    return FALSE;
+}
+
+void mock_alloc_get_stats (MockAllocStats *stats) {
+    stats->allocations = 0;
+    stats->live_bytes = 0;
+}
+
+#endif /* __GLIBC__ */
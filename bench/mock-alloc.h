@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#ifndef _MOCK_ALLOC_H_
+#define _MOCK_ALLOC_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Counts the heap allocations of the whole process, including GLib, GTK+ and
+ * cairo, by replacing malloc and friends. This only works with glibc,
+ * elsewhere mock_alloc_available returns FALSE and the counters stay zero.
+ */
+typedef struct {
+    guint64 allocations; /* calls that allocated a block */
+    gint64  live_bytes;  /* usable size of all blocks that were not freed */
+} MockAllocStats;
+
+gboolean mock_alloc_available (void);
+void     mock_alloc_get_stats (MockAllocStats *stats);
+
+G_END_DECLS
+
+#endif /* _MOCK_ALLOC_H_ */
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#include <panel-applet.h>
+
+/**
+ * The part of PanelApplet that the task list uses: the orientation and the
+ * change-orient signal. The applet is a plain event box outside of a panel.
+ */
+struct _PanelAppletPrivate {
+    PanelAppletOrient orient;
+};
+
+enum {
+    CHANGE_ORIENT,
+    LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL];
+
+G_DEFINE_TYPE_WITH_PRIVATE (PanelApplet, panel_applet, GTK_TYPE_EVENT_BOX);
+
+static void panel_applet_class_init (PanelAppletClass *klass) {
+    signals[CHANGE_ORIENT] = g_signal_new ("change-orient",
+        G_TYPE_FROM_CLASS (klass), G_SIGNAL_RUN_LAST,
+        G_STRUCT_OFFSET (PanelAppletClass, change_orient),
+        NULL, NULL, NULL, G_TYPE_NONE, 1, G_TYPE_UINT);
+}
+
+static void panel_applet_init (PanelApplet *applet) {
+    applet->priv = panel_applet_get_instance_private (applet);
+    applet->priv->orient = PANEL_APPLET_ORIENT_DOWN;
+}
+
+PanelAppletOrient panel_applet_get_orient (PanelApplet *applet) {
+    return applet->priv->orient;
+}
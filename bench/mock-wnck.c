@@ -0,0 +1,482 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#include "mock-wnck.h"
+
+#define SCREEN_WIDTH 1920
+#define SCREEN_HEIGHT 1080
+
+struct _WnckScreenPrivate {
+    GList *windows; /* in stacking order, like wnck_screen_get_windows */
+    GPtrArray *workspaces;
+    WnckWorkspace *active_workspace;
+    WnckWindow *active_window;
+};
+
+struct _WnckWorkspacePrivate {
+    WnckScreen *screen;
+    gint number;
+    gint columns; /* viewports side by side, 1 for a workspace that is not virtual */
+    gint rows;
+    gint viewport_x;
+    gint viewport_y;
+};
+
+struct _WnckWindowPrivate {
+    WnckScreen *screen;
+    WnckWorkspace *workspace; /* NULL for windows on all workspaces */
+    gchar *name;
+    gchar *class_name;
+    gchar *icon_name; /* NULL if the window has none */
+    GdkPixbuf *icon;
+    WnckWindowState state;
+    gulong xid;
+    gint x; /* relative to the top left viewport of the workspace */
+    gint y;
+};
+
+enum {
+    WINDOW_OPENED,
+    WINDOW_CLOSED,
+    ACTIVE_WINDOW_CHANGED,
+    ACTIVE_WORKSPACE_CHANGED,
+    VIEWPORTS_CHANGED,
+    WORKSPACE_CREATED,
+    WORKSPACE_DESTROYED,
+    LAST_SCREEN_SIGNAL
+};
+
+enum {
+    STATE_CHANGED,
+    WORKSPACE_CHANGED,
+    GEOMETRY_CHANGED,
+    ICON_CHANGED,
+    NAME_CHANGED,
+    LAST_WINDOW_SIGNAL
+};
+
+static guint screen_signals[LAST_SCREEN_SIGNAL];
+static guint window_signals[LAST_WINDOW_SIGNAL];
+static WnckScreen *default_screen = NULL;
+static gulong next_xid = 0x1000000;
+static guint64 icon_geometry_requests = 0;
+
+G_DEFINE_TYPE_WITH_PRIVATE (WnckScreen, wnck_screen, G_TYPE_OBJECT);
+G_DEFINE_TYPE_WITH_PRIVATE (WnckWorkspace, wnck_workspace, G_TYPE_OBJECT);
+G_DEFINE_TYPE_WITH_PRIVATE (WnckWindow, wnck_window, G_TYPE_OBJECT);
+
+static void wnck_screen_class_init (WnckScreenClass *klass) {
+    GType type = G_TYPE_FROM_CLASS (klass);
+    screen_signals[WINDOW_OPENED] = g_signal_new ("window-opened", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, WNCK_TYPE_WINDOW);
+    screen_signals[WINDOW_CLOSED] = g_signal_new ("window-closed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, WNCK_TYPE_WINDOW);
+    screen_signals[ACTIVE_WINDOW_CHANGED] = g_signal_new ("active-window-changed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, WNCK_TYPE_WINDOW);
+    screen_signals[ACTIVE_WORKSPACE_CHANGED] = g_signal_new ("active-workspace-changed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, WNCK_TYPE_WORKSPACE);
+    screen_signals[VIEWPORTS_CHANGED] = g_signal_new ("viewports-changed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+    screen_signals[WORKSPACE_CREATED] = g_signal_new ("workspace-created", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, WNCK_TYPE_WORKSPACE);
+    screen_signals[WORKSPACE_DESTROYED] = g_signal_new ("workspace-destroyed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 1, WNCK_TYPE_WORKSPACE);
+}
+
+static void wnck_screen_init (WnckScreen *screen) {
+    screen->priv = wnck_screen_get_instance_private (screen);
+    screen->priv->workspaces = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+static void wnck_workspace_class_init (WnckWorkspaceClass *klass) {
+}
+
+static void wnck_workspace_init (WnckWorkspace *workspace) {
+    workspace->priv = wnck_workspace_get_instance_private (workspace);
+}
+
+static void wnck_window_finalize (GObject *object) {
+    WnckWindowPrivate *priv = WNCK_WINDOW (object)->priv;
+    g_free (priv->name);
+    g_free (priv->class_name);
+    g_free (priv->icon_name);
+    g_clear_object (&priv->icon);
+    G_OBJECT_CLASS (wnck_window_parent_class)->finalize (object);
+}
+
+static void wnck_window_class_init (WnckWindowClass *klass) {
+    GType type = G_TYPE_FROM_CLASS (klass);
+    G_OBJECT_CLASS (klass)->finalize = wnck_window_finalize;
+    window_signals[STATE_CHANGED] = g_signal_new ("state-changed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_UINT);
+    window_signals[WORKSPACE_CHANGED] = g_signal_new ("workspace-changed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+    window_signals[GEOMETRY_CHANGED] = g_signal_new ("geometry-changed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+    window_signals[ICON_CHANGED] = g_signal_new ("icon-changed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+    window_signals[NAME_CHANGED] = g_signal_new ("name-changed", type,
+        G_SIGNAL_RUN_LAST, 0, NULL, NULL, NULL, G_TYPE_NONE, 0);
+}
+
+static void wnck_window_init (WnckWindow *window) {
+    window->priv = wnck_window_get_instance_private (window);
+}
+
+/* Screen */
+
+WnckScreen *wnck_screen_get_default (void) {
+    if (default_screen == NULL)
+        default_screen = g_object_new (WNCK_TYPE_SCREEN, NULL);
+    return default_screen;
+}
+
+GList *wnck_screen_get_windows (WnckScreen *screen) {
+    return screen->priv->windows;
+}
+
+WnckWindow *wnck_screen_get_active_window (WnckScreen *screen) {
+    return screen->priv->active_window;
+}
+
+WnckWorkspace *wnck_screen_get_active_workspace (WnckScreen *screen) {
+    return screen->priv->active_workspace;
+}
+
+int wnck_screen_get_width (WnckScreen *screen) {
+    return SCREEN_WIDTH;
+}
+
+int wnck_screen_get_height (WnckScreen *screen) {
+    return SCREEN_HEIGHT;
+}
+
+/* Workspace */
+
+void wnck_workspace_activate (WnckWorkspace *space, guint32 timestamp) {
+    WnckScreen *screen = space->priv->screen;
+    WnckWorkspace *previous = screen->priv->active_workspace;
+    if (previous == space)
+        return;
+    screen->priv->active_workspace = space;
+    g_signal_emit (screen, screen_signals[ACTIVE_WORKSPACE_CHANGED], 0, previous);
+}
+
+int wnck_workspace_get_number (WnckWorkspace *space) {
+    return space->priv->number;
+}
+
+int wnck_workspace_get_width (WnckWorkspace *space) {
+    return space->priv->columns * SCREEN_WIDTH;
+}
+
+int wnck_workspace_get_height (WnckWorkspace *space) {
+    return space->priv->rows * SCREEN_HEIGHT;
+}
+
+int wnck_workspace_get_viewport_x (WnckWorkspace *space) {
+    return space->priv->viewport_x;
+}
+
+int wnck_workspace_get_viewport_y (WnckWorkspace *space) {
+    return space->priv->viewport_y;
+}
+
+gboolean wnck_workspace_is_virtual (WnckWorkspace *space) {
+    return space->priv->columns > 1 || space->priv->rows > 1;
+}
+
+/* Window */
+
+static void mock_wnck_set_active_window (WnckScreen *screen, WnckWindow *window) {
+    WnckWindow *previous = screen->priv->active_window;
+    if (previous == window)
+        return;
+    screen->priv->active_window = window;
+    g_signal_emit (screen, screen_signals[ACTIVE_WINDOW_CHANGED], 0, previous);
+}
+
+void wnck_window_activate (WnckWindow *window, guint32 timestamp) {
+    if (window->priv->state & WNCK_WINDOW_STATE_MINIMIZED)
+        mock_wnck_window_set_state (window, WNCK_WINDOW_STATE_MINIMIZED, 0);
+    mock_wnck_set_active_window (window->priv->screen, window);
+}
+
+void wnck_window_minimize (WnckWindow *window) {
+    mock_wnck_window_set_state (window, WNCK_WINDOW_STATE_MINIMIZED, WNCK_WINDOW_STATE_MINIMIZED);
+    if (window->priv->screen->priv->active_window == window)
+        mock_wnck_set_active_window (window->priv->screen, NULL);
+}
+
+const char *wnck_window_get_name (WnckWindow *window) {
+    return window->priv->name;
+}
+
+const char *wnck_window_get_class_group_name (WnckWindow *window) {
+    return window->priv->class_name;
+}
+
+const char *wnck_window_get_role (WnckWindow *window) {
+    return NULL;
+}
+
+const char *wnck_window_get_icon_name (WnckWindow *window) {
+    return window->priv->icon_name ? window->priv->icon_name : window->priv->name;
+}
+
+gboolean wnck_window_has_icon_name (WnckWindow *window) {
+    return window->priv->icon_name != NULL;
+}
+
+GdkPixbuf *wnck_window_get_icon (WnckWindow *window) {
+    return window->priv->icon;
+}
+
+gboolean wnck_window_get_icon_is_fallback (WnckWindow *window) {
+    return FALSE;
+}
+
+gulong wnck_window_get_xid (WnckWindow *window) {
+    return window->priv->xid;
+}
+
+WnckScreen *wnck_window_get_screen (WnckWindow *window) {
+    return window->priv->screen;
+}
+
+WnckWindowType wnck_window_get_window_type (WnckWindow *window) {
+    return WNCK_WINDOW_NORMAL;
+}
+
+WnckWorkspace *wnck_window_get_workspace (WnckWindow *window) {
+    return window->priv->workspace;
+}
+
+/* Like in libwnck the position is relative to the current viewport */
+void wnck_window_get_geometry (WnckWindow *window,
+    int *xp, int *yp, int *widthp, int *heightp)
+{
+    WnckWorkspace *workspace = window->priv->workspace;
+    if (xp) *xp = window->priv->x - (workspace ? workspace->priv->viewport_x : 0);
+    if (yp) *yp = window->priv->y - (workspace ? workspace->priv->viewport_y : 0);
+    if (widthp) *widthp = SCREEN_WIDTH / 2;
+    if (heightp) *heightp = SCREEN_HEIGHT / 2;
+}
+
+gboolean wnck_window_is_active (WnckWindow *window) {
+    return window->priv->screen->priv->active_window == window;
+}
+
+gboolean wnck_window_is_minimized (WnckWindow *window) {
+    return (window->priv->state & WNCK_WINDOW_STATE_MINIMIZED) != 0;
+}
+
+gboolean wnck_window_is_pinned (WnckWindow *window) {
+    return window->priv->workspace == NULL;
+}
+
+gboolean wnck_window_is_skip_tasklist (WnckWindow *window) {
+    return (window->priv->state & WNCK_WINDOW_STATE_SKIP_TASKLIST) != 0;
+}
+
+gboolean wnck_window_is_on_workspace (WnckWindow *window, WnckWorkspace *workspace) {
+    return window->priv->workspace == NULL || window->priv->workspace == workspace;
+}
+
+gboolean wnck_window_is_in_viewport (WnckWindow *window, WnckWorkspace *workspace) {
+    gint x, y, width, height;
+    if (window->priv->workspace == NULL)
+        return TRUE;
+    if (window->priv->workspace != workspace)
+        return FALSE;
+    wnck_window_get_geometry (window, &x, &y, &width, &height);
+    return x < SCREEN_WIDTH && x + width > 0 && y < SCREEN_HEIGHT && y + height > 0;
+}
+
+gboolean wnck_window_or_transient_needs_attention (WnckWindow *window) {
+    return (window->priv->state
+            & (WNCK_WINDOW_STATE_DEMANDS_ATTENTION | WNCK_WINDOW_STATE_URGENT)) != 0;
+}
+
+/* Every call is one X request in libwnck */
+void wnck_window_set_icon_geometry (WnckWindow *window,
+    int x, int y, int width, int height)
+{
+    icon_geometry_requests++;
+}
+
+GtkWidget *wnck_action_menu_new (WnckWindow *window) {
+    return gtk_menu_new ();
+}
+
+/* Control of the mock */
+
+/**
+ * Drops all windows without emitting any signals and replaces the workspaces
+ * with n_workspaces new ones, the first of them is active. Nothing may be
+ * connected to the screen at this point.
+ */
+void mock_wnck_screen_reset (guint n_workspaces) {
+    WnckScreen *screen = wnck_screen_get_default ();
+    WnckScreenPrivate *priv = screen->priv;
+    guint i;
+    g_list_free_full (priv->windows, g_object_unref);
+    priv->windows = NULL;
+    priv->active_window = NULL;
+    g_ptr_array_set_size (priv->workspaces, 0);
+    for (i = 0; i < n_workspaces; i++) {
+        WnckWorkspace *workspace = g_object_new (WNCK_TYPE_WORKSPACE, NULL);
+        workspace->priv->screen = screen;
+        workspace->priv->number = i;
+        workspace->priv->columns = 1;
+        workspace->priv->rows = 1;
+        g_ptr_array_add (priv->workspaces, workspace);
+    }
+    priv->active_workspace = n_workspaces > 0 ? g_ptr_array_index (priv->workspaces, 0) : NULL;
+}
+
+WnckWorkspace *mock_wnck_screen_get_workspace (guint index) {
+    GPtrArray *workspaces = wnck_screen_get_default ()->priv->workspaces;
+    return index < workspaces->len ? g_ptr_array_index (workspaces, index) : NULL;
+}
+
+/**
+ * Makes the workspace a virtual one of columns by rows viewports of the size
+ * of the screen, as compiz does. Like mock_wnck_screen_reset it emits nothing
+ * and is meant to be called before the applet is created.
+ */
+void mock_wnck_workspace_set_viewports (WnckWorkspace *workspace,
+    guint columns,
+    guint rows)
+{
+    workspace->priv->columns = MAX (columns, 1);
+    workspace->priv->rows = MAX (rows, 1);
+    workspace->priv->viewport_x = 0;
+    workspace->priv->viewport_y = 0;
+}
+
+/**
+ * Scrolls the workspace to the viewport in the given column and row. The
+ * windows keep their place on the workspace, so their geometry relative to
+ * the viewport changes. geometry-changed is emitted for each of them, then
+ * viewports-changed.
+ */
+void mock_wnck_workspace_move_viewport (WnckWorkspace *workspace,
+    guint column,
+    guint row)
+{
+    WnckScreen *screen = workspace->priv->screen;
+    gint x = MIN ((gint) column, workspace->priv->columns - 1) * SCREEN_WIDTH;
+    gint y = MIN ((gint) row, workspace->priv->rows - 1) * SCREEN_HEIGHT;
+    GList *l;
+    if (x == workspace->priv->viewport_x && y == workspace->priv->viewport_y)
+        return;
+    workspace->priv->viewport_x = x;
+    workspace->priv->viewport_y = y;
+    for (l = screen->priv->windows; l; l = l->next) {
+        WnckWindow *window = l->data;
+        if (window->priv->workspace == workspace)
+            g_signal_emit (window, window_signals[GEOMETRY_CHANGED], 0);
+    }
+    g_signal_emit (screen, screen_signals[VIEWPORTS_CHANGED], 0);
+}
+
+/**
+ * Adds a window to the screen without emitting window-opened, like the
+ * windows that already exist when the applet starts. The window is on all
+ * workspaces if workspace is NULL.
+ */
+WnckWindow *mock_wnck_window_new (const gchar *name,
+    const gchar *class_name,
+    WnckWorkspace *workspace,
+    GdkPixbuf *icon)
+{
+    WnckScreen *screen = wnck_screen_get_default ();
+    WnckWindow *window = g_object_new (WNCK_TYPE_WINDOW, NULL);
+    window->priv->screen = screen;
+    window->priv->workspace = workspace;
+    window->priv->name = g_strdup (name);
+    window->priv->class_name = g_strdup (class_name);
+    window->priv->icon = icon ? g_object_ref (icon) : NULL;
+    window->priv->xid = next_xid++;
+    window->priv->x = (window->priv->xid * 37) % (SCREEN_WIDTH / 2);
+    window->priv->y = (window->priv->xid * 17) % (SCREEN_HEIGHT / 2);
+    screen->priv->windows = g_list_append (screen->priv->windows, window);
+    return window;
+}
+
+/* Emits window-opened for a window that was added with mock_wnck_window_new */
+void mock_wnck_window_open (WnckWindow *window) {
+    g_signal_emit (window->priv->screen, screen_signals[WINDOW_OPENED], 0, window);
+}
+
+/* Removes the window from the screen like libwnck does when it is destroyed */
+void mock_wnck_window_close (WnckWindow *window) {
+    WnckScreen *screen = window->priv->screen;
+    screen->priv->windows = g_list_remove (screen->priv->windows, window);
+    if (screen->priv->active_window == window)
+        mock_wnck_set_active_window (screen, NULL);
+    g_signal_emit (screen, screen_signals[WINDOW_CLOSED], 0, window);
+    g_object_unref (window);
+}
+
+void mock_wnck_window_set_icon (WnckWindow *window, GdkPixbuf *icon) {
+    g_clear_object (&window->priv->icon);
+    window->priv->icon = icon ? g_object_ref (icon) : NULL;
+    g_signal_emit (window, window_signals[ICON_CHANGED], 0);
+}
+
+/**
+ * Gives the window an icon name, or none if icon_name is NULL. Like
+ * mock_wnck_window_new it emits nothing, so it is meant for windows that are
+ * not open yet.
+ */
+void mock_wnck_window_set_icon_name (WnckWindow *window, const gchar *icon_name) {
+    g_free (window->priv->icon_name);
+    window->priv->icon_name = g_strdup (icon_name);
+}
+
+/**
+ * Moves the window to the viewport in the given column and row of its
+ * workspace, keeping its offset within the viewport, and emits
+ * geometry-changed.
+ */
+void mock_wnck_window_move_to_viewport (WnckWindow *window, guint column, guint row) {
+    window->priv->x = window->priv->x % SCREEN_WIDTH + column * SCREEN_WIDTH;
+    window->priv->y = window->priv->y % SCREEN_HEIGHT + row * SCREEN_HEIGHT;
+    g_signal_emit (window, window_signals[GEOMETRY_CHANGED], 0);
+}
+
+/* Sets the bits of mask to the ones in state and emits state-changed */
+void mock_wnck_window_set_state (WnckWindow *window,
+    WnckWindowState mask,
+    WnckWindowState state)
+{
+    WnckWindowState old_state = window->priv->state;
+    window->priv->state = (old_state & ~mask) | (state & mask);
+    if (window->priv->state != old_state) {
+        g_signal_emit (window, window_signals[STATE_CHANGED], 0,
+            old_state ^ window->priv->state, window->priv->state);
+    }
+}
+
+/* The number of wnck_window_set_icon_geometry calls so far */
+guint64 mock_wnck_get_icon_geometry_requests (void) {
+    return icon_geometry_requests;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#ifndef _MOCK_WNCK_H_
+#define _MOCK_WNCK_H_
+
+#include <libwnck/libwnck.h>
+
+G_BEGIN_DECLS
+
+/**
+ * The mock implements the part of the libwnck API that the task list uses,
+ * against the real libwnck headers, without talking to an X server. Windows
+ * and workspaces only change through the functions below, which emit the
+ * same signals that libwnck emits.
+ */
+
+void           mock_wnck_screen_reset (guint n_workspaces);
+WnckWorkspace *mock_wnck_screen_get_workspace (guint index);
+void           mock_wnck_workspace_set_viewports (WnckWorkspace *workspace,
+                                                  guint columns,
+                                                  guint rows);
+void           mock_wnck_workspace_move_viewport (WnckWorkspace *workspace,
+                                                  guint column,
+                                                  guint row);
+WnckWindow    *mock_wnck_window_new (const gchar *name,
+                                     const gchar *class_name,
+                                     WnckWorkspace *workspace,
+                                     GdkPixbuf *icon);
+void           mock_wnck_window_open (WnckWindow *window);
+void           mock_wnck_window_close (WnckWindow *window);
+void           mock_wnck_window_set_icon (WnckWindow *window, GdkPixbuf *icon);
+void           mock_wnck_window_set_icon_name (WnckWindow *window,
+                                               const gchar *icon_name);
+void           mock_wnck_window_move_to_viewport (WnckWindow *window,
+                                                  guint column,
+                                                  guint row);
+void           mock_wnck_window_set_state (WnckWindow *window,
+                                           WnckWindowState mask,
+                                           WnckWindowState state);
+guint64        mock_wnck_get_icon_geometry_requests (void);
+
+G_END_DECLS
+
+#endif /* _MOCK_WNCK_H_ */
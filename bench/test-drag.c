@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+/**
+ * Drags that come from other clients, like text or links dragged from a
+ * browser, must neither reorder the task list nor have their data read. They
+ * only activate the window that is hovered for a second. Foreign STRING drops
+ * used to be dereferenced as a TaskItem pointer. Run it with: make check
+ */
+
+#include "bench-applet.h"
+#include "mock-wnck.h"
+#include "task-icon-cache.h"
+#include "task-item.h"
+#include "task-list.h"
+#include "task-strip.h"
+
+#define PANEL_LENGTH 600
+#define PANEL_HEIGHT 32
+#define N_WINDOWS 3
+
+typedef struct {
+    GtkWidget          *toplevel;
+    WindowPickerApplet *applet;
+    WnckWindow         *windows[N_WINDOWS];
+    guint               n_activations;
+} DragFixture;
+
+static void drag_flush (DragFixture *fixture) {
+    while (g_main_context_pending (NULL))
+        g_main_context_iteration (NULL, FALSE);
+    gtk_container_check_resize (GTK_CONTAINER (fixture->toplevel));
+    gdk_window_process_updates (gtk_widget_get_window (fixture->toplevel), TRUE);
+}
+
+static gboolean on_timeout (gboolean *done) {
+    *done = TRUE;
+    return G_SOURCE_REMOVE;
+}
+
+/* Runs the main loop for the given time, so that timers can fire */
+static void drag_wait (DragFixture *fixture, guint milliseconds) {
+    gboolean done = FALSE;
+    g_timeout_add (milliseconds, (GSourceFunc) on_timeout, &done);
+    while (!done)
+        g_main_context_iteration (NULL, TRUE);
+    drag_flush (fixture);
+}
+
+static void on_active_window_changed (WnckScreen *screen,
+    WnckWindow *previous,
+    DragFixture *fixture)
+{
+    fixture->n_activations++;
+}
+
+static void drag_fixture_set_up (DragFixture *fixture, gconstpointer data) {
+    GdkPixbuf *icon = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, 48, 48);
+    guint i;
+    gdk_pixbuf_fill (icon, 0x3060a0ff);
+    mock_wnck_screen_reset (1);
+    for (i = 0; i < N_WINDOWS; i++) {
+        gchar *name = g_strdup_printf ("Window %u", i);
+        gchar *class_name = g_strdup_printf ("application-%u", i);
+        fixture->windows[i] = mock_wnck_window_new (name, class_name,
+            mock_wnck_screen_get_workspace (0), icon);
+        g_free (class_name);
+        g_free (name);
+    }
+    g_object_unref (icon);
+    wnck_window_activate (fixture->windows[N_WINDOWS - 1], 0);
+
+    fixture->applet = bench_applet_new (GPOINTER_TO_INT (data));
+    fixture->toplevel = gtk_offscreen_window_new ();
+    gtk_widget_set_size_request (GTK_WIDGET (fixture->applet), PANEL_LENGTH, PANEL_HEIGHT);
+    gtk_container_add (GTK_CONTAINER (fixture->toplevel), GTK_WIDGET (fixture->applet));
+    gtk_widget_show_all (fixture->toplevel);
+    drag_flush (fixture);
+    fixture->n_activations = 0;
+    g_signal_connect (wnck_screen_get_default (), "active-window-changed",
+        G_CALLBACK (on_active_window_changed), fixture);
+}
+
+static void drag_fixture_tear_down (DragFixture *fixture, gconstpointer data) {
+    g_signal_handlers_disconnect_by_data (wnck_screen_get_default (), fixture);
+    gtk_widget_destroy (fixture->toplevel);
+    while (g_main_context_pending (NULL))
+        g_main_context_iteration (NULL, FALSE);
+    task_icon_cache_clear ();
+}
+
+/* Returns the widget that receives the drag for the first window */
+static GtkWidget *drag_get_target (DragFixture *fixture) {
+    GtkWidget *tasks = window_picker_applet_get_tasks (fixture->applet);
+    GList *children, *l;
+    GtkWidget *target = NULL;
+    if (TASK_IS_STRIP (tasks))
+        return tasks;
+    children = gtk_container_get_children (GTK_CONTAINER (tasks));
+    for (l = children; l && !target; l = l->next) {
+        if (task_item_get_window (l->data) == fixture->windows[0])
+            target = l->data;
+    }
+    g_list_free (children);
+    return target;
+}
+
+static GList *drag_get_order (DragFixture *fixture) {
+    GtkWidget *tasks = window_picker_applet_get_tasks (fixture->applet);
+    if (TASK_IS_STRIP (tasks))
+        return NULL;
+    return gtk_container_get_children (GTK_CONTAINER (tasks));
+}
+
+static void drag_order_assert_equal (GList *a, GList *b) {
+    for (; a && b; a = a->next, b = b->next)
+        g_assert (a->data == b->data);
+    g_assert (a == NULL && b == NULL);
+}
+
+/**
+ * The context has no source widget, like every drag from another client, so
+ * the task list can not resolve it to one of its items. Its data is never
+ * requested, so it does not matter which targets it offers.
+ */
+static void test_foreign_drag (DragFixture *fixture, gconstpointer data) {
+    GdkDragContext *context = g_object_new (GDK_TYPE_DRAG_CONTEXT, NULL);
+    GtkWidget *target = drag_get_target (fixture);
+    GList *order = drag_get_order (fixture);
+    GList *order_after;
+    gint x = 1, y = PANEL_HEIGHT / 2;
+    gboolean handled = FALSE;
+
+    g_assert (target != NULL);
+    g_assert (gtk_drag_get_source_widget (context) == NULL);
+
+    /* hovering and leaving again cancels the activation */
+    g_signal_emit_by_name (target, "drag-motion", context, x, y, 0, &handled);
+    g_signal_emit_by_name (target, "drag-leave", context, 0);
+    drag_wait (fixture, 1200);
+    g_assert_cmpuint (fixture->n_activations, ==, 0);
+
+    /* motion within the item and the drop itself do nothing, the window is
+     * activated once by the timer */
+    g_signal_emit_by_name (target, "drag-motion", context, x, y, 0, &handled);
+    g_signal_emit_by_name (target, "drag-motion", context, x + 1, y, 0, &handled);
+    g_signal_emit_by_name (target, "drag-drop", context, x + 1, y, 0, &handled);
+    g_assert (!handled);
+    drag_flush (fixture);
+    g_assert_cmpuint (fixture->n_activations, ==, 0);
+    drag_wait (fixture, 1200);
+    g_assert_cmpuint (fixture->n_activations, ==, 1);
+    g_assert (wnck_screen_get_active_window (wnck_screen_get_default ()) == fixture->windows[0]);
+
+    order_after = drag_get_order (fixture);
+    drag_order_assert_equal (order, order_after);
+    g_list_free (order_after);
+    g_list_free (order);
+    g_object_unref (context);
+}
+
+int main (int argc, char **argv) {
+    g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+    if (!gtk_init_check (&argc, &argv)) {
+        g_printerr ("test-drag: cannot open a display, run it under xvfb-run\n");
+        return 77;
+    }
+    g_test_init (&argc, &argv, NULL);
+    g_test_add ("/drag/foreign/list", DragFixture, GINT_TO_POINTER (FALSE),
+        drag_fixture_set_up, test_foreign_drag, drag_fixture_tear_down);
+    g_test_add ("/drag/foreign/strip", DragFixture, GINT_TO_POINTER (TRUE),
+        drag_fixture_set_up, test_foreign_drag, drag_fixture_tear_down);
+    return g_test_run ();
+}
@@ -24,11 +24,15 @@
 
 #include "task-title.h"
 #include "task-list.h"
+#include "task-strip.h"
+#include "task-debug.h"
 #include "applet.h"
 
 #include <string.h>
+#include <signal.h>
 
 #include <glib.h>
+#include <glib-unix.h>
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
 
@@ -42,11 +46,13 @@
 #define KEY_SHOW_HOME_TITLE        "show-home-title"
 #define KEY_ICONS_GREYSCALE        "icons-greyscale"
 #define KEY_EXPAND_TASK_LIST       "expand-task-list"
+#define KEY_SINGLE_WIDGET_RENDERER "single-widget-renderer"
 
 struct _WindowPickerAppletPrivate {
     GtkWidget *tasks;
     GtkWidget *title; /* a pointer to the window title widget */
     GSettings *settings;
+    guint debug_dump_source; /* SIGUSR1 handler to dump debug information */
 
     gboolean show_all_windows;
     gboolean show_application_title;
@@ -127,8 +133,54 @@ static void setupPanelContextMenu(WindowPickerApplet *windowPickerApplet) {
     g_object_unref (action_group);
 }
 
+/**
+ * Dumps the collected debug information to stderr, this is triggered by
+ * sending SIGUSR1 to the applet process while WINDOW_PICKER_DEBUG is set.
+ */
+static gboolean
+on_debug_dump_requested (WindowPickerApplet *windowPickerApplet) {
+    GtkWidget *tasks = windowPickerApplet->priv->tasks;
+    task_debug_write_trace ();
+    if (task_debug_enabled (TASK_DEBUG_MEMORY)) {
+        if (TASK_IS_STRIP (tasks))
+            task_strip_dump_memory (TASK_STRIP (tasks));
+        else
+            task_list_dump_memory (TASK_LIST (tasks));
+        task_title_dump_memory (TASK_TITLE (windowPickerApplet->priv->title));
+    }
+    if (task_debug_enabled (TASK_DEBUG_STATS)) {
+        task_debug_dump_stats ();
+        /* the single widget renderer does not count these */
+        if (TASK_IS_LIST (tasks)) {
+            g_printerr ("urgency animation wakeups in the last second: %u\n",
+                task_list_get_animation_wakeups (TASK_LIST (tasks)));
+            g_printerr ("X requests saved by batched minimize hints: %" G_GUINT64_FORMAT "\n",
+                task_list_get_icon_geometry_saved (TASK_LIST (tasks)));
+        }
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static PanelAppletFlags
+window_picker_applet_get_panel_flags (WindowPickerApplet *windowPickerApplet) {
+    PanelAppletFlags flags = PANEL_APPLET_EXPAND_MINOR | PANEL_APPLET_HAS_HANDLE;
+    if (windowPickerApplet->priv->expand_task_list)
+        flags |= PANEL_APPLET_EXPAND_MAJOR;
+    return flags;
+}
+
+static void
+on_expand_task_list_changed (WindowPickerApplet *windowPickerApplet,
+                             GParamSpec *pspec,
+                             gpointer user_data)
+{
+    panel_applet_set_flags (PANEL_APPLET (windowPickerApplet),
+        window_picker_applet_get_panel_flags (windowPickerApplet));
+}
+
 static gboolean
 load_window_picker (PanelApplet *applet) {
+    TASK_PROBE_SCOPE ("applet.c: load_window_picker");
     WindowPickerApplet *windowPickerApplet = WINDOW_PICKER_APPLET(applet);
     WindowPickerAppletPrivate *priv = windowPickerApplet->priv;
     GSettings *settings = windowPickerApplet->priv->settings
@@ -140,7 +192,12 @@ load_window_picker (PanelApplet *applet) {
     gtk_container_set_border_width (GTK_CONTAINER (applet), 0);
     gtk_container_set_border_width (GTK_CONTAINER (grid), 0);
 
-    priv->tasks = task_list_new (windowPickerApplet);
+    /* the renderer is only chosen at startup */
+    if (g_settings_get_boolean (settings, KEY_SINGLE_WIDGET_RENDERER)) {
+        priv->tasks = task_strip_new (windowPickerApplet);
+    } else {
+        priv->tasks = task_list_new (windowPickerApplet);
+    }
     gtk_widget_set_vexpand (priv->tasks, TRUE);
     gtk_grid_attach (GTK_GRID(grid), priv->tasks, 0, 0, 1, 1);
 
@@ -172,11 +229,14 @@ load_window_picker (PanelApplet *applet) {
     loadAppletStyle (GTK_WIDGET (applet));
     setupPanelContextMenu (windowPickerApplet);
 
-    PanelAppletFlags flags = PANEL_APPLET_EXPAND_MINOR | PANEL_APPLET_HAS_HANDLE;
-    if (g_settings_get_boolean(priv->settings, KEY_EXPAND_TASK_LIST))
-        flags |= PANEL_APPLET_EXPAND_MAJOR;
+    if (task_debug_get_flags ()) {
+        priv->debug_dump_source = g_unix_signal_add (SIGUSR1,
+            (GSourceFunc) on_debug_dump_requested, windowPickerApplet);
+    }
 
-    panel_applet_set_flags(applet, flags);
+    panel_applet_set_flags(applet, window_picker_applet_get_panel_flags (windowPickerApplet));
+    g_signal_connect (windowPickerApplet, "notify::expand-task-list",
+            G_CALLBACK (on_expand_task_list_changed), NULL);
     panel_applet_set_background_widget (applet, GTK_WIDGET(applet));
 
     gtk_widget_show_all(GTK_WIDGET (applet));
@@ -289,6 +349,7 @@ window_picker_factory (PanelApplet *applet,
                        const gchar *iid,
                        gpointer data)
 {
+    TASK_PROBE_SCOPE ("applet.c: window_picker_factory");
     gboolean result = FALSE;
     static gboolean type_registered = FALSE;
 
@@ -367,6 +428,11 @@ static void
 window_picker_finalize(GObject *object) {
     WindowPickerApplet *windowPickerApplet = WINDOW_PICKER_APPLET(object);
 
+    if (windowPickerApplet->priv->debug_dump_source) {
+        g_source_remove (windowPickerApplet->priv->debug_dump_source);
+        windowPickerApplet->priv->debug_dump_source = 0;
+    }
+
     if (windowPickerApplet->priv->settings) {
         g_object_unref(windowPickerApplet->priv->settings);
         windowPickerApplet->priv->settings = NULL;
@@ -383,6 +449,7 @@ window_picker_applet_init (WindowPickerApplet *picker)
     picker->priv->title = NULL;
 
     picker->priv->settings = NULL;
+    picker->priv->debug_dump_source = 0;
 }
 
 static void
@@ -430,6 +497,17 @@ GtkWidget
     return picker->priv->tasks;
 }
 
+/**
+ * Returns TRUE if all windows of the task list are minimized, whichever
+ * renderer shows them.
+ */
+gboolean
+window_picker_applet_get_desktop_visible (WindowPickerApplet *picker) {
+    if (TASK_IS_STRIP (picker->priv->tasks))
+        return task_strip_get_desktop_visible (TASK_STRIP (picker->priv->tasks));
+    return task_list_get_desktop_visible (TASK_LIST (picker->priv->tasks));
+}
+
 gboolean
 window_picker_applet_get_show_all_windows(WindowPickerApplet *picker) {
     return picker->priv->show_all_windows;
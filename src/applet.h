@@ -49,6 +49,7 @@ GType window_picker_applet_get_type (void) G_GNUC_CONST;
 /* Getters for private fields */
 GSettings *window_picker_applet_get_settings (WindowPickerApplet *picker);
 GtkWidget* window_picker_applet_get_tasks (WindowPickerApplet* windowPickerApplet);
+gboolean window_picker_applet_get_desktop_visible (WindowPickerApplet *picker);
 gboolean window_picker_applet_get_show_all_windows (WindowPickerApplet *picker);
 gboolean window_picker_applet_get_show_application_title (WindowPickerApplet *picker);
 gboolean window_picker_applet_get_show_home_title (WindowPickerApplet *picker);
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#include "task-cell.h"
+
+#include <math.h>
+
+/* D&D stuff */
+
+static const GtkTargetEntry drop_types[] = {
+    { "STRING", 0, 0 },
+    { "text/plain", 0, 0},
+    { "text/uri-list", 0, 0},
+    { "task-item", GTK_TARGET_SAME_APP, 0 } //drag and drop target
+};
+
+static const gint n_drop_types = G_N_ELEMENTS(drop_types);
+
+/* Dragged windows are resolved in process by the TaskList and the TaskStrip,
+ * this target only exists so that GTK starts a drag, its data is never
+ * requested. */
+static const GtkTargetEntry drag_types[] = {
+    { "task-item", GTK_TARGET_SAME_APP, 0 } //drag and drop source
+};
+
+static const gint n_drag_types = G_N_ELEMENTS(drag_types);
+
+/* Returns TRUE if the window gets a cell in the task list */
+gboolean task_cell_is_task_window (WnckWindow *window) {
+    WnckWindowType type = wnck_window_get_window_type (window);
+    return type != WNCK_WINDOW_DESKTOP
+        && type != WNCK_WINDOW_DOCK
+        && type != WNCK_WINDOW_SPLASHSCREEN
+        && type != WNCK_WINDOW_MENU;
+}
+
+/**
+ * Returns TRUE if the cell of the window is shown. in_view tells if the
+ * window is on the active workspace, or in the active viewport of a virtual
+ * workspace, show_all is the show-all-windows setting.
+ */
+gboolean task_cell_is_window_shown (WnckWindow *window,
+    gboolean in_view,
+    gboolean show_all)
+{
+    if (wnck_window_is_skip_tasklist (window))
+        return FALSE;
+    return in_view || show_all;
+}
+
+/**
+ * Makes widget both the target and the source of a drag and drop operation.
+ * As a target it can receive strings (e.g. links), as a source a window can
+ * be dragged to another position on the task list.
+ */
+void task_cell_set_drag_targets (GtkWidget *widget) {
+    //target (destination)
+    gtk_drag_dest_set (
+        widget,
+        GTK_DEST_DEFAULT_HIGHLIGHT,
+        drop_types, n_drop_types,
+        GDK_ACTION_COPY
+    );
+    gtk_drag_dest_add_uri_targets (widget);
+    gtk_drag_dest_add_text_targets (widget);
+
+    //source
+    gtk_drag_source_set (
+        widget,
+        GDK_BUTTON1_MASK,
+        drag_types,
+        n_drag_types,
+        GDK_ACTION_COPY
+    );
+}
+
+/**
+ * Draws the cell of window into area of cr, this draws the different states
+ * of the icon, for example the rectangle around an active icon, the white
+ * circle on hover, etc. The urgency animation started at *urgent_time, which
+ * is set to now when it starts and reset when the window no longer needs
+ * attention.
+ */
+void task_cell_draw (GtkWidget *widget,
+    cairo_t *cr,
+    GdkRectangle *area,
+    WnckWindow *window,
+    TaskIcon *icon,
+    gboolean mouse_over,
+    gboolean icons_greyscale,
+    gint64 *urgent_time,
+    gint64 now)
+{
+    gboolean active = wnck_window_is_active (window);
+    gboolean attention = wnck_window_or_transient_needs_attention (window);
+    if (active) { /* paint frame around the icon */
+        /* We add -1 for x to make it bigger to the left
+         * and +1 for width to make it bigger at the right */
+        cairo_rectangle (cr, area->x + 1, area->y + 1, area->width - 2, area->height - 2);
+        cairo_set_source_rgba (cr, .8, .8, .8, .2);
+        cairo_fill_preserve (cr);
+        if (mouse_over) {
+            cairo_set_source_rgba (cr, .9, .9, 1, 0.45);
+            cairo_stroke (cr);
+        } else {
+            cairo_set_line_width (cr, 1);
+            cairo_set_source_rgba (cr, .8, .8, .8, .4);
+            cairo_stroke (cr);
+        }
+    } else if (mouse_over) {
+        int glow_x, glow_y;
+        cairo_pattern_t *glow_pattern;
+        glow_x = area->width / 2;
+        glow_y = area->height / 2;
+        glow_pattern = cairo_pattern_create_radial (
+            area->x + glow_x, area->y + glow_y, glow_x * 0.6,
+            area->x + glow_x, area->y + glow_y, glow_x * 1.5
+        );
+        cairo_pattern_add_color_stop_rgba (glow_pattern, 0, 1, 1, 1, 1);
+        cairo_pattern_add_color_stop_rgba (glow_pattern, 0.4, 1, 1, 1, 0);
+        cairo_set_source (cr, glow_pattern);
+        cairo_paint (cr);
+        cairo_pattern_destroy (glow_pattern);
+    }
+    task_icon_redraw_when_loaded (icon, widget);
+    gboolean greyscale = !(active || mouse_over || attention || !icons_greyscale);
+    gint scale = task_icon_get_scale (icon);
+    /* the surface has a device scale, so it is positioned in logical pixels */
+    cairo_set_source_surface (
+        cr,
+        task_icon_get_surface (icon, greyscale, gtk_widget_get_window (widget)),
+        (area->x + (area->width - task_icon_get_width (icon) / scale) / 2),
+        (area->y + (area->height - task_icon_get_height (icon) / scale) / 2)
+    );
+    if (!attention) {
+        *urgent_time = 0;
+    }
+    if (!mouse_over && attention) { /* urgent */
+        if (!*urgent_time)
+            *urgent_time = now;
+        gdouble ms = (now - *urgent_time) / 1000.0;
+        gdouble alpha = .66 + (cos (3.15 * ms / 600) / 3);
+        cairo_paint_with_alpha (cr, alpha);
+    } else if (mouse_over || active || !icons_greyscale) { /* focused */
+        cairo_paint (cr);
+    } else { /* not focused */
+        cairo_paint_with_alpha (cr, .65);
+    }
+}
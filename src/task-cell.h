@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#ifndef _TASK_CELL_H_
+#define _TASK_CELL_H_
+
+#include "task-icon-cache.h"
+
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <libwnck/libwnck.h>
+
+G_BEGIN_DECLS
+
+/**
+ * A cell is the square that shows one window, either as a TaskItem of the
+ * task list or as a part of the TaskStrip. Both renderers use the functions
+ * below, so that they pick the same windows and draw them the same way.
+ */
+
+#define DEFAULT_TASK_ITEM_HEIGHT 26
+//make the cells two pixles wider to allow for space of the border
+#define DEFAULT_TASK_ITEM_WIDTH (28 + 2)
+
+gboolean task_cell_is_task_window (WnckWindow *window);
+gboolean task_cell_is_window_shown (WnckWindow *window,
+                                    gboolean in_view,
+                                    gboolean show_all);
+void     task_cell_set_drag_targets (GtkWidget *widget);
+void     task_cell_draw (GtkWidget *widget,
+                         cairo_t *cr,
+                         GdkRectangle *area,
+                         WnckWindow *window,
+                         TaskIcon *icon,
+                         gboolean mouse_over,
+                         gboolean icons_greyscale,
+                         gint64 *urgent_time,
+                         gint64 now);
+
+G_END_DECLS
+
+#endif /* _TASK_CELL_H_ */
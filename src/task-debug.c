@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#include "task-debug.h"
+
+#include <gdk/gdk.h>
+#ifdef GDK_WINDOWING_X11
+#include <gdk/gdkx.h>
+#endif
+#include <unistd.h>
+
+/* Tracing stops after this many spans, which is roughly 16 MiB of memory */
+#define TRACE_MAX_EVENTS 500000
+
+static const GDebugKey debug_keys[] = {
+    { "check", TASK_DEBUG_CHECK },
+    { "stats", TASK_DEBUG_STATS },
+    { "trace", TASK_DEBUG_TRACE },
+    { "memory", TASK_DEBUG_MEMORY },
+};
+
+typedef struct {
+    const gchar *name; /* owned by the probe */
+    gint64       start;
+    gint64       duration;
+} TraceEvent;
+
+/* All probes that recorded at least once, in the order of their first use */
+static GSList *probes = NULL;
+/* All spans in the order they ended, only used with WINDOW_PICKER_DEBUG=trace */
+static GArray *trace_events = NULL;
+static guint trace_dropped = 0;
+
+guint task_debug_get_flags (void) {
+    static gboolean initialized = FALSE;
+    static guint flags = 0;
+    if (!initialized) {
+        flags = g_parse_debug_string (g_getenv ("WINDOW_PICKER_DEBUG"),
+            debug_keys, G_N_ELEMENTS (debug_keys));
+        initialized = TRUE;
+    }
+    return flags;
+}
+
+/**
+ * Returns the start time for task_probe_end, or 0 if stats and tracing are
+ * disabled
+ */
+gint64 task_probe_begin (TaskProbe *probe) {
+    if (!task_debug_enabled (TASK_DEBUG_STATS | TASK_DEBUG_TRACE))
+        return 0;
+    if (!probe->registered) {
+        probes = g_slist_append (probes, probe);
+        probe->registered = TRUE;
+    }
+    return g_get_monotonic_time ();
+}
+
+void task_probe_end (TaskProbe *probe, gint64 start) {
+    if (start == 0)
+        return;
+    gint64 elapsed = g_get_monotonic_time () - start;
+    probe->calls++;
+    probe->total_time += elapsed;
+    if (elapsed > probe->max_time)
+        probe->max_time = elapsed;
+    if (task_debug_enabled (TASK_DEBUG_TRACE)) {
+        TraceEvent event = { probe->name, start, elapsed };
+        if (trace_events == NULL)
+            trace_events = g_array_sized_new (FALSE, FALSE, sizeof (TraceEvent), 4096);
+        if (trace_events->len < TRACE_MAX_EVENTS)
+            g_array_append_val (trace_events, event);
+        else
+            trace_dropped++;
+    }
+}
+
+void task_probe_scope_end (TaskProbeScope *scope) {
+    task_probe_end (scope->probe, scope->start);
+}
+
+/**
+ * Prints the call count and the total, average and maximum latency of every
+ * probe to stderr
+ */
+void task_debug_dump_stats (void) {
+    GSList *l;
+    if (!task_debug_enabled (TASK_DEBUG_STATS))
+        return;
+    g_printerr ("%-48s %10s %12s %10s %10s\n",
+        "window-picker-applet", "calls", "total (ms)", "avg (us)", "max (us)");
+    for (l = probes; l; l = l->next) {
+        TaskProbe *probe = l->data;
+        g_printerr ("%-48s %10" G_GUINT64_FORMAT " %12.3f %10.1f %10" G_GINT64_FORMAT "\n",
+            probe->name,
+            probe->calls,
+            probe->total_time / 1000.0,
+            probe->calls ? (gdouble) probe->total_time / probe->calls : 0.0,
+            probe->max_time);
+    }
+}
+
+static gchar *trace_get_path (void) {
+    const gchar *path = g_getenv ("WINDOW_PICKER_TRACE_FILE");
+    gchar *name;
+    gchar *result;
+    if (path && *path)
+        return g_strdup (path);
+    name = g_strdup_printf ("window-picker-applet-%d.json", (gint) getpid ());
+    result = g_build_filename (g_get_tmp_dir (), name, NULL);
+    g_free (name);
+    return result;
+}
+
+/**
+ * Writes all spans recorded so far in the Chrome trace event format, which
+ * can be opened with chrome://tracing, Perfetto or speedscope. The file is
+ * rewritten on every call so it always contains the complete trace.
+ */
+void task_debug_write_trace (void) {
+    GString *json;
+    GError *error = NULL;
+    gchar *path;
+    gint pid = (gint) getpid ();
+    guint i;
+    if (!task_debug_enabled (TASK_DEBUG_TRACE) || trace_events == NULL)
+        return;
+    json = g_string_sized_new (trace_events->len * 96 + 256);
+    g_string_append (json, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    g_string_append_printf (json,
+        "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+        "\"args\":{\"name\":\"window-picker-applet\"}}", pid, pid);
+    for (i = 0; i < trace_events->len; i++) {
+        TraceEvent *event = &g_array_index (trace_events, TraceEvent, i);
+        gchar *name = g_strescape (event->name, NULL);
+        g_string_append_printf (json,
+            ",\n{\"name\":\"%s\",\"cat\":\"window-picker\",\"ph\":\"X\","
+            "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ","
+            "\"pid\":%d,\"tid\":%d}",
+            name, event->start, event->duration, pid, pid);
+        g_free (name);
+    }
+    g_string_append (json, "\n]}\n");
+
+    path = trace_get_path ();
+    if (g_file_set_contents (path, json->str, json->len, &error)) {
+        g_printerr ("window-picker-applet: wrote %u trace events to %s",
+            trace_events->len, path);
+        if (trace_dropped)
+            g_printerr (" (%u later events were dropped)", trace_dropped);
+        g_printerr ("\n");
+    } else {
+        g_warning ("Could not write the trace %s: %s", path, error->message);
+        g_error_free (error);
+    }
+    g_free (path);
+    g_string_free (json, TRUE);
+}
+
+/**
+ * Returns the number of signal handlers connected to instance. GObject has no
+ * API to count them, so the handlers of every signal of the type and its
+ * parents are blocked, which returns their number, and unblocked again.
+ */
+guint task_debug_count_handlers (gpointer instance) {
+    GType type;
+    guint count = 0;
+    g_return_val_if_fail (G_IS_OBJECT (instance), 0);
+    for (type = G_TYPE_FROM_INSTANCE (instance); type != 0; type = g_type_parent (type)) {
+        guint n_ids, i;
+        guint *ids = g_signal_list_ids (type, &n_ids);
+        for (i = 0; i < n_ids; i++) {
+            count += g_signal_handlers_block_matched (instance,
+                G_SIGNAL_MATCH_ID, ids[i], 0, NULL, NULL, NULL);
+            g_signal_handlers_unblock_matched (instance,
+                G_SIGNAL_MATCH_ID, ids[i], 0, NULL, NULL, NULL);
+        }
+        g_free (ids);
+    }
+    return count;
+}
+
+/**
+ * Returns the serial of the next request to the X server, so the difference
+ * of two calls is the number of requests sent in between. Returns 0 if the
+ * default display is not an X11 display.
+ */
+guint64 task_debug_get_x_requests (void) {
+#ifdef GDK_WINDOWING_X11
+    GdkDisplay *display = gdk_display_get_default ();
+    if (display && GDK_IS_X11_DISPLAY (display))
+        return NextRequest (gdk_x11_display_get_xdisplay (display));
+#endif
+    return 0;
+}
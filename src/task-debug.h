@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#ifndef _TASK_DEBUG_H_
+#define _TASK_DEBUG_H_
+
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Debug features are enabled at runtime with the WINDOW_PICKER_DEBUG
+ * environment variable, e.g. WINDOW_PICKER_DEBUG=check
+ */
+typedef enum {
+    TASK_DEBUG_CHECK = 1 << 0, /* cross-check incremental state with full scans */
+    TASK_DEBUG_STATS = 1 << 1, /* measure the latency of operations */
+    TASK_DEBUG_TRACE = 1 << 2, /* record every probe as a span in a trace file */
+    TASK_DEBUG_MEMORY = 1 << 3, /* report memory, handlers and timers on demand */
+} TaskDebugFlags;
+
+guint task_debug_get_flags (void);
+
+#define task_debug_enabled(flag) ((task_debug_get_flags () & (flag)) != 0)
+
+/**
+ * A probe accumulates how often an operation ran and how long it took. Probes
+ * are statically allocated and only record anything with
+ * WINDOW_PICKER_DEBUG=stats or trace, otherwise they cost a flag check.
+ */
+typedef struct {
+    const gchar *name;
+    guint64      calls;
+    gint64       total_time; /* in microseconds */
+    gint64       max_time;   /* in microseconds */
+    gboolean     registered;
+} TaskProbe;
+
+typedef struct {
+    TaskProbe *probe;
+    gint64     start;
+} TaskProbeScope;
+
+gint64 task_probe_begin (TaskProbe *probe);
+void   task_probe_end (TaskProbe *probe, gint64 start);
+void   task_probe_scope_end (TaskProbeScope *scope);
+void   task_debug_dump_stats (void);
+void   task_debug_write_trace (void);
+guint  task_debug_count_handlers (gpointer instance);
+guint64 task_debug_get_x_requests (void);
+
+/**
+ * Measures the enclosing function from this point until it returns
+ */
+#define TASK_PROBE_SCOPE(probe_name) \
+    static TaskProbe _task_probe = { probe_name, 0, 0, 0, FALSE }; \
+    TaskProbeScope _task_probe_scope __attribute__ ((cleanup (task_probe_scope_end))) \
+        = { &_task_probe, task_probe_begin (&_task_probe) }
+
+G_END_DECLS
+
+#endif /* _TASK_DEBUG_H_ */
@@ -0,0 +1,603 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#include "task-icon-cache.h"
+#include "task-icon-store.h"
+#include "task-debug.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+struct _TaskIcon {
+    gint       ref_count;
+    gchar     *key;
+    gint       size; /* in logical pixels */
+    gint       scale; /* the pixbuf has size * scale device pixels */
+    gboolean   stale; /* evicted from the cache, holders should look up again */
+    gboolean   persistent; /* the icon is written to the icon store */
+    gboolean   loading; /* the surface is a placeholder until the load finished */
+    guint32    stamp; /* the stamp of the source, see icon_cache_get_stamp */
+    GSList    *waiting; /* weak pointers to widgets that painted the placeholder */
+    /* The ready to paint icon, either converted from a freshly loaded pixbuf
+     * or taken from the icon store. The pixbuf and the desaturated variant
+     * are created on demand. While the icon is loading, the surface and the
+     * pixbuf hold a placeholder. */
+    cairo_surface_t *surface;
+    GdkPixbuf *pixbuf;
+    cairo_surface_t *greyscale;
+};
+
+/* Maps the cache key to a TaskIcon, the table does not hold a reference.
+ * An icon removes itself from the table when its last reference is dropped.
+ */
+static GHashTable *icon_cache = NULL;
+static gchar *icon_theme_name = NULL;
+static guint32 icon_theme_stamp = 0; /* 0 until it is computed */
+static guint icon_loads = 0; /* icons that are being loaded */
+
+static void on_icon_theme_changed (GtkIconTheme *theme, gpointer data) {
+    task_icon_cache_clear ();
+    task_icon_store_clear ();
+}
+
+static void icon_cache_ensure (void) {
+    if (icon_cache)
+        return;
+    icon_cache = g_hash_table_new (g_str_hash, g_str_equal);
+    g_signal_connect (gtk_icon_theme_get_default (), "changed",
+        G_CALLBACK (on_icon_theme_changed), NULL);
+}
+
+static const gchar *icon_cache_get_theme_name (void) {
+    if (!icon_theme_name) {
+        g_object_get (gtk_settings_get_default (),
+            "gtk-icon-theme-name", &icon_theme_name,
+            NULL);
+    }
+    return icon_theme_name ? icon_theme_name : "";
+}
+
+static guint32 icon_stamp_add (guint32 stamp, guint32 value) {
+    return stamp * 33 + value;
+}
+
+static guint32 icon_stamp_add_file (guint32 stamp, const gchar *path) {
+    GStatBuf buf;
+    if (g_stat (path, &buf) != 0)
+        return icon_stamp_add (stamp, 0);
+    stamp = icon_stamp_add (stamp, (guint32) buf.st_mtime);
+    return icon_stamp_add (stamp, (guint32) buf.st_size);
+}
+
+/**
+ * Returns a stamp of the directories of the icon theme and of hicolor, which
+ * every theme inherits, and of their icon-theme.cache files. It changes when
+ * icons are installed or updated, since that rebuilds the cache file.
+ */
+static guint32 icon_cache_get_theme_stamp (void) {
+    const gchar *theme = icon_cache_get_theme_name ();
+    const gchar *themes[] = { theme, "hicolor" };
+    gchar **search_path;
+    gint n_search_path, i;
+    guint j;
+    if (icon_theme_stamp)
+        return icon_theme_stamp;
+    guint32 stamp = g_str_hash (theme);
+    gtk_icon_theme_get_search_path (gtk_icon_theme_get_default (),
+        &search_path, &n_search_path);
+    for (i = 0; i < n_search_path; i++) {
+        stamp = icon_stamp_add_file (stamp, search_path[i]);
+        for (j = 0; j < G_N_ELEMENTS (themes); j++) {
+            gchar *dir = g_build_filename (search_path[i], themes[j], NULL);
+            gchar *cache = g_build_filename (dir, "icon-theme.cache", NULL);
+            stamp = icon_stamp_add_file (stamp, dir);
+            stamp = icon_stamp_add_file (stamp, cache);
+            g_free (cache);
+            g_free (dir);
+        }
+    }
+    g_strfreev (search_path);
+    icon_theme_stamp = stamp ? stamp : 1;
+    return icon_theme_stamp;
+}
+
+/**
+ * Returns the stamp that a stored icon must have to be used: the stamp of the
+ * theme directories for themed icons, and a checksum of the window icon for
+ * the others, so that icons which changed on disk or in the application
+ * between two sessions are loaded again.
+ */
+static guint32 icon_cache_get_stamp (WnckWindow *window, gboolean themed) {
+    if (themed)
+        return icon_cache_get_theme_stamp ();
+    GdkPixbuf *pixbuf = wnck_window_get_icon (window);
+    const guchar *pixels = gdk_pixbuf_get_pixels (pixbuf);
+    gsize length = gdk_pixbuf_get_byte_length (pixbuf);
+    guint32 stamp = icon_stamp_add (gdk_pixbuf_get_width (pixbuf), gdk_pixbuf_get_height (pixbuf));
+    gsize i;
+    for (i = 0; i < length; i++)
+        stamp = icon_stamp_add (stamp, pixels[i]);
+    return stamp;
+}
+
+/**
+ * Windows of the same application share their icon. We use the themed icon
+ * name if there is one, otherwise the window class, and only fall back to the
+ * window itself if neither is known.
+ */
+static gchar *icon_cache_key_for_window (WnckWindow *window,
+                                         gboolean themed,
+                                         gint size,
+                                         gint scale)
+{
+    const gchar *theme = icon_cache_get_theme_name ();
+    if (themed) {
+        return g_strdup_printf ("%s|name:%s|%d@%d", theme,
+            wnck_window_get_icon_name (window), size, scale);
+    }
+    const gchar *class_name = wnck_window_get_class_group_name (window);
+    if (class_name && *class_name) {
+        return g_strdup_printf ("%s|class:%s|%d@%d", theme, class_name, size, scale);
+    }
+    return g_strdup_printf ("%s|window:%lu|%d@%d", theme,
+        wnck_window_get_xid (window), size, scale);
+}
+
+/* An icon that is being loaded, it holds a reference to the icon */
+typedef struct {
+    TaskIcon  *icon;
+    GdkPixbuf *fallback; /* the icon of the window, used if the theme has none */
+    GdkPixbuf *pixbuf; /* the pixbuf that is scaled by the worker thread */
+    gint       size; /* in device pixels */
+    gint64     start;
+} IconLoad;
+
+static TaskProbe icon_load_probe = { "icon load", 0, 0, 0, FALSE };
+
+static void icon_load_free (IconLoad *load) {
+    g_clear_object (&load->pixbuf);
+    g_object_unref (load->fallback);
+    task_icon_unref (load->icon);
+    g_slice_free (IconLoad, load);
+}
+
+/* Returns a new pixbuf whose larger side is size pixels */
+static GdkPixbuf *icon_scale_pixbuf (GdkPixbuf *pixbuf, gint size, GdkInterpType interp) {
+    gint width = gdk_pixbuf_get_width (pixbuf);
+    gint height = gdk_pixbuf_get_height (pixbuf);
+    if (MAX (width, height) == size)
+        return g_object_ref (pixbuf);
+    gdouble factor = (gdouble) size / (gdouble) MAX (width, height);
+    return gdk_pixbuf_scale_simple (pixbuf,
+        MAX (1, (gint) (width * factor)), MAX (1, (gint) (height * factor)), interp);
+}
+
+/**
+ * Replaces the placeholder of the icon with the loaded pixbuf, stores it and
+ * redraws the widgets that painted the placeholder. Without a pixbuf the
+ * placeholder is kept, but the icon leaves the cache so that it is never
+ * stored and the next lookup loads it again.
+ */
+static void icon_load_finish (IconLoad *load, GdkPixbuf *pixbuf) {
+    TaskIcon *icon = load->icon;
+    GSList *l;
+    icon_loads--;
+    icon->loading = FALSE;
+    if (pixbuf) {
+        cairo_surface_destroy (icon->surface);
+        icon->surface = gdk_cairo_surface_create_from_pixbuf (pixbuf, icon->scale, NULL);
+        g_clear_object (&icon->pixbuf);
+        icon->pixbuf = pixbuf;
+        if (icon->greyscale) {
+            cairo_surface_destroy (icon->greyscale);
+            icon->greyscale = NULL;
+        }
+        if (icon->persistent && !icon->stale)
+            task_icon_store_add (icon->key, icon->surface, icon->scale, icon->stamp);
+    } else if (!icon->stale) {
+        icon->stale = TRUE;
+        g_hash_table_remove (icon_cache, icon->key);
+    }
+    for (l = icon->waiting; l; l = l->next) {
+        if (l->data) {
+            g_object_remove_weak_pointer (l->data, &l->data);
+            /* the placeholder is already painted, a failed load is retried
+             * with the next draw instead of right away */
+            if (pixbuf)
+                gtk_widget_queue_draw (l->data);
+        }
+    }
+    g_slist_free (icon->waiting);
+    icon->waiting = NULL;
+    task_probe_end (&icon_load_probe, load->start);
+    icon_load_free (load);
+}
+
+/* Runs in a worker thread and only touches the pixbuf of the load */
+static void icon_scale_thread (GTask *task,
+                               gpointer source_object,
+                               gpointer task_data,
+                               GCancellable *cancellable)
+{
+    IconLoad *load = task_data;
+    g_task_return_pointer (task,
+        icon_scale_pixbuf (load->pixbuf, load->size, GDK_INTERP_HYPER),
+        g_object_unref);
+}
+
+static void on_icon_scaled (GObject *source, GAsyncResult *result, gpointer data) {
+    IconLoad *load = data;
+    /* scaling fails if the pixbuf can not be allocated */
+    icon_load_finish (load, g_task_propagate_pointer (G_TASK (result), NULL));
+}
+
+/* Takes the reference to pixbuf */
+static void icon_load_scale (IconLoad *load, GdkPixbuf *pixbuf) {
+    GTask *task = g_task_new (NULL, NULL, on_icon_scaled, load);
+    load->pixbuf = pixbuf;
+    g_task_set_task_data (task, load, NULL);
+    g_task_run_in_thread (task, icon_scale_thread);
+    g_object_unref (task);
+}
+
+static void on_themed_icon_loaded (GObject *source, GAsyncResult *result, gpointer data) {
+    IconLoad *load = data;
+    GdkPixbuf *pixbuf = gtk_icon_info_load_icon_finish (GTK_ICON_INFO (source), result, NULL);
+    if (!pixbuf) {
+        icon_load_scale (load, g_object_ref (load->fallback));
+    } else if (MAX (gdk_pixbuf_get_width (pixbuf), gdk_pixbuf_get_height (pixbuf)) != load->size) {
+        icon_load_scale (load, pixbuf);
+    } else {
+        icon_load_finish (load, pixbuf);
+    }
+}
+
+/**
+ * Starts loading the icon at size * scale device pixels. Themed icons are
+ * read and decoded by GTK in a thread, other icons are scaled in a worker
+ * thread. Until then the icon shows the in-memory icon of the window with a
+ * fast scaling filter.
+ */
+static void icon_cache_load (TaskIcon *icon, WnckWindow *window, gboolean themed) {
+    IconLoad *load = g_slice_new0 (IconLoad);
+    GtkIconInfo *info = NULL;
+    load->start = task_probe_begin (&icon_load_probe);
+    load->icon = task_icon_ref (icon);
+    load->fallback = g_object_ref (wnck_window_get_icon (window));
+    load->size = icon->size * icon->scale;
+
+    icon_loads++;
+    icon->loading = TRUE;
+    icon->pixbuf = icon_scale_pixbuf (load->fallback, load->size, GDK_INTERP_BILINEAR);
+    icon->surface = gdk_cairo_surface_create_from_pixbuf (icon->pixbuf, icon->scale, NULL);
+
+    if (themed) {
+        info = gtk_icon_theme_lookup_icon_for_scale (gtk_icon_theme_get_default (),
+            wnck_window_get_icon_name (window),
+            icon->size,
+            icon->scale,
+            GTK_ICON_LOOKUP_FORCE_SIZE
+        );
+    }
+    if (info) {
+        gtk_icon_info_load_icon_async (info, NULL, on_themed_icon_loaded, load);
+        g_object_unref (info);
+    } else if (MAX (gdk_pixbuf_get_width (load->fallback),
+                    gdk_pixbuf_get_height (load->fallback)) == load->size) {
+        icon_load_finish (load, g_object_ref (load->fallback));
+    } else {
+        icon_load_scale (load, g_object_ref (load->fallback));
+    }
+}
+
+/**
+ * Returns a new reference to the icon of the window at the given logical size
+ * and scale factor. The icon is only loaded and scaled if no other window of
+ * the same application already uses it or is loading it, and if it is not in
+ * the icon store. Icons of a scale that is no longer in use drop out of the
+ * cache with their last reference.
+ */
+TaskIcon *task_icon_cache_lookup (WnckWindow *window, gint size, gint scale) {
+    g_return_val_if_fail (WNCK_IS_WINDOW (window), NULL);
+    g_return_val_if_fail (size > 0, NULL);
+    g_return_val_if_fail (scale > 0, NULL);
+    icon_cache_ensure ();
+
+    gboolean themed = wnck_window_has_icon_name (window)
+        && gtk_icon_theme_has_icon (gtk_icon_theme_get_default (),
+               wnck_window_get_icon_name (window));
+    gchar *key = icon_cache_key_for_window (window, themed, size, scale);
+    TaskIcon *icon = g_hash_table_lookup (icon_cache, key);
+    if (icon) {
+        g_free (key);
+        return task_icon_ref (icon);
+    }
+
+    icon = g_slice_new0 (TaskIcon);
+    icon->ref_count = 1;
+    icon->key = key;
+    icon->size = size;
+    icon->scale = scale;
+    /* icons of a single window can not be found again after a restart */
+    gboolean reusable = themed || strstr (key, "|window:") == NULL;
+    /* the default icon of a window that did not set its own icon yet would
+     * otherwise be stored for the whole application */
+    icon->persistent = reusable && (themed || !wnck_window_get_icon_is_fallback (window));
+    g_hash_table_insert (icon_cache, icon->key, icon);
+    if (reusable) {
+        icon->stamp = icon_cache_get_stamp (window, themed);
+        icon->surface = task_icon_store_lookup (key, scale, icon->stamp);
+    }
+    if (!icon->surface)
+        icon_cache_load (icon, window, themed);
+    return icon;
+}
+
+/**
+ * Removes the icon from the cache and the icon store, for example because the
+ * window icon changed. Current holders keep a valid icon but see it as stale.
+ */
+void task_icon_cache_evict (TaskIcon *icon) {
+    g_return_if_fail (icon != NULL);
+    if (icon->stale)
+        return;
+    icon->stale = TRUE;
+    g_hash_table_remove (icon_cache, icon->key);
+    task_icon_store_remove (icon->key);
+}
+
+/**
+ * Frees the greyscale variants of all cached icons, they are only needed while
+ * non active icons are greyed out and are converted again when needed.
+ */
+void task_icon_cache_drop_greyscale (void) {
+    GHashTableIter iter;
+    gpointer icon;
+    if (!icon_cache)
+        return;
+    g_hash_table_iter_init (&iter, icon_cache);
+    while (g_hash_table_iter_next (&iter, NULL, &icon)) {
+        TaskIcon *taskIcon = icon;
+        if (taskIcon->greyscale) {
+            cairo_surface_destroy (taskIcon->greyscale);
+            taskIcon->greyscale = NULL;
+        }
+    }
+}
+
+void task_icon_cache_clear (void) {
+    GHashTableIter iter;
+    gpointer icon;
+    if (!icon_cache)
+        return;
+    g_hash_table_iter_init (&iter, icon_cache);
+    while (g_hash_table_iter_next (&iter, NULL, &icon)) {
+        ((TaskIcon *) icon)->stale = TRUE;
+        g_hash_table_iter_remove (&iter);
+    }
+    g_free (icon_theme_name);
+    icon_theme_name = NULL;
+    icon_theme_stamp = 0;
+}
+
+/**
+ * Writes the icons that wait to be stored, called when the task list goes away
+ */
+void task_icon_cache_flush (void) {
+    task_icon_store_flush ();
+}
+
+/**
+ * Returns the number of icons that still show their placeholder
+ */
+guint task_icon_cache_get_n_loading (void) {
+    return icon_loads;
+}
+
+/**
+ * Returns the bytes held by all cached icons and their number
+ */
+gsize task_icon_cache_get_memory_size (guint *n_icons) {
+    GHashTableIter iter;
+    gpointer icon;
+    gsize size = 0;
+    if (n_icons)
+        *n_icons = icon_cache ? g_hash_table_size (icon_cache) : 0;
+    if (!icon_cache)
+        return 0;
+    g_hash_table_iter_init (&iter, icon_cache);
+    while (g_hash_table_iter_next (&iter, NULL, &icon)) {
+        size += task_icon_get_memory_size (icon);
+    }
+    return size;
+}
+
+TaskIcon *task_icon_ref (TaskIcon *icon) {
+    g_return_val_if_fail (icon != NULL, NULL);
+    icon->ref_count++;
+    return icon;
+}
+
+void task_icon_unref (TaskIcon *icon) {
+    g_return_if_fail (icon != NULL);
+    if (--icon->ref_count > 0)
+        return;
+    if (!icon->stale)
+        g_hash_table_remove (icon_cache, icon->key);
+    g_clear_object (&icon->pixbuf);
+    cairo_surface_destroy (icon->surface);
+    if (icon->greyscale)
+        cairo_surface_destroy (icon->greyscale);
+    g_free (icon->key);
+    g_slice_free (TaskIcon, icon);
+}
+
+/**
+ * Queues a draw of the widget once the icon is loaded, if it still shows
+ * its placeholder.
+ */
+void task_icon_redraw_when_loaded (TaskIcon *icon, GtkWidget *widget) {
+    g_return_if_fail (icon != NULL);
+    if (!icon->loading || g_slist_find (icon->waiting, widget))
+        return;
+    icon->waiting = g_slist_prepend (icon->waiting, widget);
+    g_object_add_weak_pointer (G_OBJECT (widget), &icon->waiting->data);
+}
+
+gboolean task_icon_is_stale (TaskIcon *icon) {
+    g_return_val_if_fail (icon != NULL, TRUE);
+    return icon->stale;
+}
+
+gint task_icon_get_size (TaskIcon *icon) {
+    g_return_val_if_fail (icon != NULL, 0);
+    return icon->size;
+}
+
+gint task_icon_get_scale (TaskIcon *icon) {
+    g_return_val_if_fail (icon != NULL, 1);
+    return icon->scale;
+}
+
+/* The width and height of the icon in device pixels */
+gint task_icon_get_width (TaskIcon *icon) {
+    g_return_val_if_fail (icon != NULL, 0);
+    return cairo_image_surface_get_width (icon->surface);
+}
+
+gint task_icon_get_height (TaskIcon *icon) {
+    g_return_val_if_fail (icon != NULL, 0);
+    return cairo_image_surface_get_height (icon->surface);
+}
+
+/**
+ * Returns the bytes of the surface, the pixbuf and the greyscale variant of
+ * the icon. Surfaces that live in the X server are estimated at 4 bytes per
+ * pixel, surfaces from the icon store are counted although they are backed by
+ * the mapped file.
+ */
+gsize task_icon_get_memory_size (TaskIcon *icon) {
+    gsize pixel_size = (gsize) task_icon_get_width (icon) * task_icon_get_height (icon) * 4;
+    gsize size = sizeof (TaskIcon) + strlen (icon->key) + 1;
+    size += (gsize) cairo_image_surface_get_stride (icon->surface)
+        * cairo_image_surface_get_height (icon->surface);
+    if (icon->pixbuf)
+        size += gdk_pixbuf_get_byte_length (icon->pixbuf);
+    if (icon->greyscale) {
+        if (cairo_surface_get_type (icon->greyscale) == CAIRO_SURFACE_TYPE_IMAGE) {
+            size += (gsize) cairo_image_surface_get_stride (icon->greyscale)
+                * cairo_image_surface_get_height (icon->greyscale);
+        } else {
+            size += pixel_size;
+        }
+    }
+    return size;
+}
+
+/**
+ * Converts the premultiplied surface of an icon from the icon store back into
+ * a pixbuf.
+ */
+static GdkPixbuf *icon_create_pixbuf_from_surface (cairo_surface_t *surface) {
+    gint width = cairo_image_surface_get_width (surface);
+    gint height = cairo_image_surface_get_height (surface);
+    gint stride = cairo_image_surface_get_stride (surface);
+    gboolean has_alpha = cairo_image_surface_get_format (surface) == CAIRO_FORMAT_ARGB32;
+    GdkPixbuf *pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, width, height);
+    gint rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+    guchar *pixels = gdk_pixbuf_get_pixels (pixbuf);
+    const guchar *data;
+    gint x, y;
+    cairo_surface_flush (surface);
+    data = cairo_image_surface_get_data (surface);
+    for (y = 0; y < height; y++) {
+        const guint32 *src = (const guint32 *) (data + y * stride);
+        guchar *dst = pixels + y * rowstride;
+        for (x = 0; x < width; x++, dst += 4) {
+            guint32 pixel = src[x];
+            guint alpha = has_alpha ? pixel >> 24 : 0xff;
+            guint red = (pixel >> 16) & 0xff;
+            guint green = (pixel >> 8) & 0xff;
+            guint blue = pixel & 0xff;
+            if (alpha == 0) {
+                red = green = blue = 0;
+            } else if (alpha < 0xff) {
+                red = (red * 0xff + alpha / 2) / alpha;
+                green = (green * 0xff + alpha / 2) / alpha;
+                blue = (blue * 0xff + alpha / 2) / alpha;
+            }
+            dst[0] = red;
+            dst[1] = green;
+            dst[2] = blue;
+            dst[3] = alpha;
+        }
+    }
+    return pixbuf;
+}
+
+GdkPixbuf *task_icon_get_pixbuf (TaskIcon *icon) {
+    g_return_val_if_fail (icon != NULL, NULL);
+    if (!icon->pixbuf)
+        icon->pixbuf = icon_create_pixbuf_from_surface (icon->surface);
+    return icon->pixbuf;
+}
+
+static GdkPixbuf *icon_create_greyscale_pixbuf (GdkPixbuf *pixbuf) {
+    GdkPixbuf *desat = gdk_pixbuf_new (
+        GDK_COLORSPACE_RGB,
+        TRUE,
+        gdk_pixbuf_get_bits_per_sample (pixbuf),
+        gdk_pixbuf_get_width (pixbuf),
+        gdk_pixbuf_get_height (pixbuf)
+    );
+    if (desat) {
+        gdk_pixbuf_saturate_and_pixelate (
+            pixbuf,
+            desat,
+            0, //means zero saturation == gray
+            FALSE
+        );
+    } else { /* just use the colored version as a fallback */
+        desat = g_object_ref (pixbuf);
+    }
+    return desat;
+}
+
+/**
+ * Returns the icon as a premultiplied cairo image surface, so that drawing it
+ * is a plain surface paint. The surface carries the device scale of the icon,
+ * so it is painted at its logical size without being scaled again. The
+ * greyscale variant is converted once for the given GdkWindow and then kept
+ * together with the icon.
+ */
+cairo_surface_t *task_icon_get_surface (TaskIcon *icon,
+                                        gboolean greyscale,
+                                        GdkWindow *window)
+{
+    g_return_val_if_fail (icon != NULL, NULL);
+    if (greyscale) {
+        if (!icon->greyscale) {
+            GdkPixbuf *desat = icon_create_greyscale_pixbuf (task_icon_get_pixbuf (icon));
+            icon->greyscale = gdk_cairo_surface_create_from_pixbuf (desat, icon->scale, window);
+            g_object_unref (desat);
+        }
+        return icon->greyscale;
+    }
+    return icon->surface;
+}
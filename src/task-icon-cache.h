@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#ifndef _TASK_ICON_CACHE_H_
+#define _TASK_ICON_CACHE_H_
+
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <libwnck/libwnck.h>
+
+G_BEGIN_DECLS
+
+/**
+ * A TaskIcon is a scaled window icon that is shared between all task items
+ * that show the same icon (same icon name or window class) at the same size,
+ * scale factor and with the same icon theme. Icons are loaded asynchronously,
+ * until then they show a quickly scaled copy of the window icon.
+ */
+typedef struct _TaskIcon TaskIcon;
+
+TaskIcon  *task_icon_cache_lookup (WnckWindow *window, gint size, gint scale);
+void       task_icon_cache_evict (TaskIcon *icon);
+void       task_icon_cache_clear (void);
+void       task_icon_cache_flush (void);
+guint      task_icon_cache_get_n_loading (void);
+void       task_icon_cache_drop_greyscale (void);
+gsize      task_icon_cache_get_memory_size (guint *n_icons);
+
+TaskIcon  *task_icon_ref (TaskIcon *icon);
+void       task_icon_unref (TaskIcon *icon);
+gboolean   task_icon_is_stale (TaskIcon *icon);
+void       task_icon_redraw_when_loaded (TaskIcon *icon, GtkWidget *widget);
+gint       task_icon_get_size (TaskIcon *icon);
+gint       task_icon_get_scale (TaskIcon *icon);
+gint       task_icon_get_width (TaskIcon *icon);
+gint       task_icon_get_height (TaskIcon *icon);
+GdkPixbuf *task_icon_get_pixbuf (TaskIcon *icon);
+gsize      task_icon_get_memory_size (TaskIcon *icon);
+cairo_surface_t *task_icon_get_surface (TaskIcon *icon,
+                                        gboolean greyscale,
+                                        GdkWindow *window);
+
+G_END_DECLS
+
+#endif /* _TASK_ICON_CACHE_H_ */
@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#include "task-icon-store.h"
+#include "task-debug.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#define STORE_MAGIC 0x43495057 /* "WPIC" in native byte order */
+#define STORE_VERSION 3
+#define STORE_MAX_SIZE (8 * 1024 * 1024)
+#define STORE_SAVE_DELAY 10 /* seconds */
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE (1, 14, 0)
+#define STORE_HAS_DEVICE_SCALE 1
+#endif
+
+/* The file starts with a StoreHeader which is followed by n_entries entries.
+ * Each entry is a StoreEntryHeader, followed by the NUL terminated key padded
+ * to key_length bytes and by height * stride bytes of cairo image data, so
+ * that all data stays 4 byte aligned. The file is only valid for the machine
+ * that wrote it. Entries are written from the most to the least recently
+ * used one, and the least recently used ones are dropped when the file
+ * reaches STORE_MAX_SIZE. */
+typedef struct {
+    guint32 magic;
+    guint32 version;
+    guint32 n_entries;
+} StoreHeader;
+
+typedef struct {
+    guint32 key_length;
+    guint32 format;
+    guint32 width;
+    guint32 height;
+    guint32 stride;
+    guint32 scale;
+    guint32 stamp; /* the stamp of the source of the icon */
+    guint32 last_used; /* seconds since the epoch of the last hit */
+} StoreEntryHeader;
+
+/* The recency of an icon, use_order orders the hits of this session that
+ * happened within the same second */
+typedef struct {
+    guint32 last_used;
+    guint32 use_order;
+} StoreUse;
+
+typedef struct {
+    const StoreEntryHeader *header;
+    const guchar *data;
+    StoreUse use;
+} StoreEntry;
+
+typedef struct {
+    cairo_surface_t *surface;
+    gint scale;
+    guint32 stamp;
+    StoreUse use;
+} StorePending;
+
+/* An icon that store_save writes, either a pending one or one of the file */
+typedef struct {
+    const gchar *key;
+    StoreEntryHeader header;
+    const guchar *data;
+    StoreUse use;
+} StoreCandidate;
+
+static GMappedFile *store_file = NULL;
+static GHashTable *store_index = NULL; /* maps keys to StoreEntry in store_file */
+static GHashTable *store_pending = NULL; /* icons that are not written yet */
+static guint store_save_source = 0;
+static guint32 store_use_order = 0;
+static const cairo_user_data_key_t store_file_key;
+
+static TaskProbe store_load_probe = { "icon store load", 0, 0, 0, FALSE };
+static TaskProbe store_hit_probe = { "icon store hit", 0, 0, 0, FALSE };
+
+static gchar *store_get_path (void) {
+    return g_build_filename (g_get_user_cache_dir (),
+        "window-picker-applet", "icons.cache", NULL);
+}
+
+static gsize store_align (gsize size) {
+    return (size + 3) & ~((gsize) 3);
+}
+
+static gboolean store_format_is_valid (guint32 format, guint32 width, guint32 stride) {
+    if (format != CAIRO_FORMAT_ARGB32 && format != CAIRO_FORMAT_RGB24)
+        return FALSE;
+    return width > 0 && stride == (guint32) cairo_format_stride_for_width (format, width);
+}
+
+static void store_use_touch (StoreUse *use) {
+    use->last_used = g_get_real_time () / G_USEC_PER_SEC;
+    use->use_order = ++store_use_order;
+}
+
+/* Sorts the most recently used candidates first */
+static gint store_candidate_compare (gconstpointer a, gconstpointer b) {
+    const StoreUse *use_a = &((const StoreCandidate *) a)->use;
+    const StoreUse *use_b = &((const StoreCandidate *) b)->use;
+    if (use_a->last_used != use_b->last_used)
+        return use_a->last_used > use_b->last_used ? -1 : 1;
+    if (use_a->use_order != use_b->use_order)
+        return use_a->use_order > use_b->use_order ? -1 : 1;
+    return 0;
+}
+
+static void store_pending_free (StorePending *pending) {
+    cairo_surface_destroy (pending->surface);
+    g_slice_free (StorePending, pending);
+}
+
+/**
+ * Builds the index of the mapped file, the index points into the mapping so
+ * nothing is copied. Returns FALSE if the file is invalid or outdated.
+ */
+static gboolean store_parse (GMappedFile *file) {
+    const gchar *contents = g_mapped_file_get_contents (file);
+    gsize length = g_mapped_file_get_length (file);
+    const StoreHeader *header = (const StoreHeader *) contents;
+    gsize offset = sizeof (StoreHeader);
+    guint32 i;
+
+    if (contents == NULL || length < sizeof (StoreHeader)
+        || header->magic != STORE_MAGIC || header->version != STORE_VERSION)
+    {
+        return FALSE;
+    }
+    for (i = 0; i < header->n_entries; i++) {
+        const StoreEntryHeader *entry_header;
+        const gchar *key;
+        StoreEntry *entry;
+        gsize data_size;
+        if (length - offset < sizeof (StoreEntryHeader))
+            return FALSE;
+        entry_header = (const StoreEntryHeader *) (contents + offset);
+        offset += sizeof (StoreEntryHeader);
+        if (entry_header->key_length == 0
+            || entry_header->key_length % 4 != 0
+            || length - offset < entry_header->key_length)
+        {
+            return FALSE;
+        }
+        key = contents + offset;
+        if (memchr (key, '\0', entry_header->key_length) == NULL)
+            return FALSE;
+        offset += entry_header->key_length;
+        if (!store_format_is_valid (entry_header->format, entry_header->width, entry_header->stride))
+            return FALSE;
+        data_size = (gsize) entry_header->stride * entry_header->height;
+        if (length - offset < data_size)
+            return FALSE;
+        entry = g_new (StoreEntry, 1);
+        entry->header = entry_header;
+        entry->data = (const guchar *) contents + offset;
+        entry->use.last_used = entry_header->last_used;
+        entry->use.use_order = 0;
+        g_hash_table_insert (store_index, (gpointer) key, entry);
+        offset += data_size;
+    }
+    return TRUE;
+}
+
+static void store_map (void) {
+    gint64 start = task_probe_begin (&store_load_probe);
+    gchar *path = store_get_path ();
+    store_file = g_mapped_file_new (path, FALSE, NULL);
+    g_free (path);
+    if (store_file && !store_parse (store_file)) {
+        g_hash_table_remove_all (store_index);
+        g_mapped_file_unref (store_file);
+        store_file = NULL;
+    }
+    task_probe_end (&store_load_probe, start);
+}
+
+static void store_ensure (void) {
+    if (store_index)
+        return;
+    store_index = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+    store_pending = g_hash_table_new_full (g_str_hash, g_str_equal,
+        g_free, (GDestroyNotify) store_pending_free);
+    store_map ();
+}
+
+static gboolean store_append_entry (GByteArray *bytes, StoreCandidate *candidate) {
+    StoreEntryHeader header = candidate->header;
+    gsize key_size = strlen (candidate->key) + 1;
+    gsize data_size = (gsize) header.stride * header.height;
+    header.key_length = store_align (key_size);
+    header.last_used = candidate->use.last_used;
+    if (bytes->len + sizeof (header) + header.key_length + data_size > STORE_MAX_SIZE)
+        return FALSE;
+    g_byte_array_append (bytes, (const guint8 *) &header, sizeof (header));
+    g_byte_array_append (bytes, (const guint8 *) candidate->key, key_size);
+    g_byte_array_set_size (bytes, bytes->len + header.key_length - key_size);
+    memset (bytes->data + bytes->len - (header.key_length - key_size), 0, header.key_length - key_size);
+    g_byte_array_append (bytes, candidate->data, data_size);
+    return TRUE;
+}
+
+/**
+ * Writes the new icons and the icons of the current file from the most to the
+ * least recently used one until the size limit is reached, and then maps the
+ * new file.
+ */
+static gboolean store_save (gpointer user_data) {
+    TASK_PROBE_SCOPE ("task-icon-store.c: store_save");
+    GByteArray *bytes = g_byte_array_new ();
+    GArray *candidates = g_array_new (FALSE, FALSE, sizeof (StoreCandidate));
+    StoreHeader header = { STORE_MAGIC, STORE_VERSION, 0 };
+    GHashTableIter iter;
+    gpointer key, value;
+    GError *error = NULL;
+    gchar *path, *dir;
+    guint i;
+
+    store_save_source = 0;
+    g_hash_table_iter_init (&iter, store_pending);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        StorePending *pending = value;
+        StoreCandidate candidate = { key, { 0, }, NULL, pending->use };
+        cairo_surface_flush (pending->surface);
+        candidate.header.format = cairo_image_surface_get_format (pending->surface);
+        candidate.header.width = cairo_image_surface_get_width (pending->surface);
+        candidate.header.height = cairo_image_surface_get_height (pending->surface);
+        candidate.header.stride = cairo_image_surface_get_stride (pending->surface);
+        candidate.header.scale = pending->scale;
+        candidate.header.stamp = pending->stamp;
+        candidate.data = cairo_image_surface_get_data (pending->surface);
+        g_array_append_val (candidates, candidate);
+    }
+    g_hash_table_iter_init (&iter, store_index);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        StoreEntry *entry = value;
+        StoreCandidate candidate = { key, *entry->header, entry->data, entry->use };
+        if (!g_hash_table_contains (store_pending, key))
+            g_array_append_val (candidates, candidate);
+    }
+    g_array_sort (candidates, store_candidate_compare);
+
+    g_byte_array_append (bytes, (const guint8 *) &header, sizeof (header));
+    for (i = 0; i < candidates->len; i++) {
+        if (!store_append_entry (bytes, &g_array_index (candidates, StoreCandidate, i)))
+            break;
+        header.n_entries++;
+    }
+    memcpy (bytes->data, &header, sizeof (header));
+    g_array_free (candidates, TRUE);
+
+    path = store_get_path ();
+    dir = g_path_get_dirname (path);
+    g_mkdir_with_parents (dir, 0700);
+    /* the file is replaced atomically, surfaces of the old mapping stay valid */
+    if (!g_file_set_contents (path, (const gchar *) bytes->data, bytes->len, &error)) {
+        g_warning ("Could not write the icon cache %s: %s", path, error->message);
+        g_error_free (error);
+    }
+    g_free (dir);
+    g_free (path);
+    g_byte_array_free (bytes, TRUE);
+
+    g_hash_table_remove_all (store_pending);
+    g_hash_table_remove_all (store_index);
+    if (store_file) {
+        g_mapped_file_unref (store_file);
+        store_file = NULL;
+    }
+    store_map ();
+    return G_SOURCE_REMOVE;
+}
+
+static void store_queue_save (void) {
+    if (store_save_source == 0) {
+        store_save_source = g_timeout_add_seconds (STORE_SAVE_DELAY, store_save, NULL);
+    }
+}
+
+/**
+ * Writes a queued save right away, so that icons that were loaded shortly
+ * before the applet goes away are in the file at the next start.
+ */
+void task_icon_store_flush (void) {
+    if (store_save_source == 0)
+        return;
+    g_source_remove (store_save_source);
+    store_save (NULL);
+}
+
+/**
+ * Returns a surface for the stored icon, or NULL if there is none for this
+ * scale and stamp. The surface points directly into the mapped file and keeps
+ * the mapping alive. An outdated icon stays in the file until it is replaced
+ * by task_icon_store_add.
+ */
+cairo_surface_t *task_icon_store_lookup (const gchar *key, gint scale, guint32 stamp) {
+    g_return_val_if_fail (key != NULL, NULL);
+    store_ensure ();
+
+    StorePending *pending = g_hash_table_lookup (store_pending, key);
+    if (pending && pending->scale == scale && pending->stamp == stamp) {
+        store_use_touch (&pending->use);
+        return cairo_surface_reference (pending->surface);
+    }
+    StoreEntry *entry = g_hash_table_lookup (store_index, key);
+    if (entry == NULL || entry->header->scale != (guint32) scale
+        || entry->header->stamp != stamp)
+    {
+        return NULL;
+    }
+#ifndef STORE_HAS_DEVICE_SCALE
+    if (scale != 1)
+        return NULL;
+#endif
+    gint64 start = task_probe_begin (&store_hit_probe);
+    store_use_touch (&entry->use);
+    cairo_surface_t *surface = cairo_image_surface_create_for_data (
+        (guchar *) entry->data,
+        entry->header->format,
+        entry->header->width,
+        entry->header->height,
+        entry->header->stride
+    );
+#ifdef STORE_HAS_DEVICE_SCALE
+    cairo_surface_set_device_scale (surface, scale, scale);
+#endif
+    cairo_surface_set_user_data (surface, &store_file_key,
+        g_mapped_file_ref (store_file), (cairo_destroy_func_t) g_mapped_file_unref);
+    task_probe_end (&store_hit_probe, start);
+    return surface;
+}
+
+/**
+ * Queues the icon to be written to the store, writes are collected and done
+ * a few seconds later.
+ */
+void task_icon_store_add (const gchar *key,
+                          cairo_surface_t *surface,
+                          gint scale,
+                          guint32 stamp)
+{
+    g_return_if_fail (key != NULL && surface != NULL);
+    store_ensure ();
+    if (cairo_surface_get_type (surface) != CAIRO_SURFACE_TYPE_IMAGE
+        || !store_format_is_valid (cairo_image_surface_get_format (surface),
+               cairo_image_surface_get_width (surface),
+               cairo_image_surface_get_stride (surface)))
+    {
+        return;
+    }
+    StorePending *pending = g_slice_new (StorePending);
+    pending->surface = cairo_surface_reference (surface);
+    pending->scale = scale;
+    pending->stamp = stamp;
+    store_use_touch (&pending->use);
+    g_hash_table_insert (store_pending, g_strdup (key), pending);
+    store_queue_save ();
+}
+
+/**
+ * Drops the stored icon, for example because the window icon changed. The
+ * file is rewritten without it.
+ */
+void task_icon_store_remove (const gchar *key) {
+    g_return_if_fail (key != NULL);
+    if (!store_index)
+        return;
+    gboolean removed = g_hash_table_remove (store_pending, key);
+    removed = g_hash_table_remove (store_index, key) || removed;
+    if (removed)
+        store_queue_save ();
+}
+
+/**
+ * Drops all stored icons, for example because the icon theme changed. The
+ * file is rewritten with the icons that are added afterwards.
+ */
+void task_icon_store_clear (void) {
+    if (!store_index)
+        return;
+    g_hash_table_remove_all (store_pending);
+    g_hash_table_remove_all (store_index);
+    if (store_file) {
+        g_mapped_file_unref (store_file);
+        store_file = NULL;
+    }
+    store_queue_save ();
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#ifndef _TASK_ICON_STORE_H_
+#define _TASK_ICON_STORE_H_
+
+#include <glib.h>
+#include <cairo.h>
+
+G_BEGIN_DECLS
+
+/**
+ * The icon store keeps scaled and premultiplied icon bitmaps in a file in the
+ * user cache directory, so that after a restart icons can be painted straight
+ * from the memory mapped file without loading or scaling them again. Icons
+ * are stored under the keys of the icon cache, together with a stamp of the
+ * source they were loaded from. A stored icon whose stamp differs from the
+ * current one is outdated and not returned.
+ */
+cairo_surface_t *task_icon_store_lookup (const gchar *key,
+                                         gint scale,
+                                         guint32 stamp);
+void             task_icon_store_add (const gchar *key,
+                                      cairo_surface_t *surface,
+                                      gint scale,
+                                      guint32 stamp);
+void             task_icon_store_remove (const gchar *key);
+void             task_icon_store_clear (void);
+void             task_icon_store_flush (void);
+
+G_END_DECLS
+
+#endif /* _TASK_ICON_STORE_H_ */
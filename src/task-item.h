@@ -45,10 +45,13 @@ struct _TaskItem {
 
 struct _TaskItemClass {
     GtkEventBoxClass   parent_class;
-    void (* itemclosed) (TaskItem *item);
 };
 
 GType task_item_get_type (void) G_GNUC_CONST;
 GtkWidget * task_item_new (WindowPickerApplet *windowPickerApplet, WnckWindow *window);
+WnckWindow *task_item_get_window (TaskItem *item);
+void        task_item_set_visibility (TaskItem *item, gboolean in_view);
+void        task_item_icon_changed (TaskItem *item);
+gsize       task_item_dump_memory (TaskItem *item);
 
 #endif /* _TASK_ITEM_H_ */
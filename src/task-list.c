@@ -20,58 +20,778 @@
 
 #include "task-list.h"
 #include "task-item.h"
+#include "task-cell.h"
+#include "task-icon-cache.h"
+#include "task-debug.h"
 
+#include <glib/gi18n.h>
 #include <libwnck/libwnck.h>
 #include <panel-applet.h>
 
+/**
+ * The state of a drag of one of our own items. The dragged item is resolved in
+ * process from the drag context, so reordering never has to go through the
+ * selection.
+ */
+typedef struct {
+    GdkDragContext *context;
+    TaskItem *source; /* the dragged item, NULL once it was closed */
+    TaskItem *target; /* the item the drag was last seen over */
+    gint64 start;
+    guint64 x_requests; /* the X request serial when the drag started */
+    guint reorders;
+} TaskDragSession;
+
 struct _TaskListPrivate {
     WnckScreen *screen;
-    guint timer;
+    GHashTable *items; /* maps each WnckWindow to its TaskItem */
+    GSequence *order; /* the TaskItems in the order in which they are shown */
+    GHashTable *positions; /* maps each TaskItem to its iter in order */
+    gchar **saved_order; /* application identities in the order the user chose */
+    GHashTable *ranks; /* maps each identity in saved_order to its index */
+    GHashTable *item_ranks; /* maps each TaskItem to its rank, order is sorted by rank */
+    guint order_save_source;
+    GHashTable *urgent_items; /* the subset of items that need attention */
+    guint n_unminimized; /* number of windows in items that are not minimized */
+    guint animation_tick; /* tick callback id of the urgency animation */
+    gint64 wakeup_period_start;
+    guint wakeups; /* animation ticks in the current second */
+    guint wakeup_rate; /* animation ticks in the last full second */
+    GQueue *pending; /* windows that still need an item after startup */
+    guint populate_source;
+    gint64 startup_time; /* only set if stats or tracing are enabled */
+    GHashTable *buckets; /* maps a bucket key to the set of items in it */
+    GHashTable *item_buckets; /* maps each item to the list of its bucket keys */
+    gint active_bucket; /* the bucket of the active workspace and viewport */
+    GHashTable *dirty_items; /* items whose visibility needs to be updated */
+    gboolean all_dirty; /* the visibility of all items needs to be updated */
+    guint visibility_source;
+    GHashTable *icon_geometries; /* the last icon geometry sent for each item */
+    guint icon_geometry_tick;
+    guint64 icon_geometry_saved; /* X requests saved by batching the updates */
+    TaskDragSession *drag; /* the drag of an item that is in progress */
+    GtkWidget *overflow_button; /* internal child for the items that do not fit */
+    GtkWidget *overflow_menu;
+    guint n_overflow; /* number of visible items behind the overflow button */
     WindowPickerApplet *windowPickerApplet;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (TaskList, task_list, GTK_TYPE_BOX);
 
-static void on_task_item_closed (
-    TaskItem *item,
-    TaskList *list)
+/* The number of items created per idle callback during startup */
+#define POPULATE_BATCH_SIZE 16
+
+/* The order of the items is saved in the settings of the applet instance,
+ * a while after the last reorder. */
+#define KEY_TASK_ORDER "task-order"
+#define ORDER_SAVE_DELAY 2 /* seconds */
+#define ORDER_MAX_ENTRIES 128
+#define NO_RANK G_MAXINT
+
+static TaskProbe startup_probe = { "startup population", 0, 0, 0, FALSE };
+static TaskProbe first_paint_probe = { "startup to first paint", 0, 0, 0, FALSE };
+
+/**
+ * A single frame clock driven animation repaints all items whose window needs
+ * attention. It only runs while there are such items, and like any frame clock
+ * callback it does not tick while the panel is not visible.
+ */
+static gboolean on_animation_tick (GtkWidget *widget,
+    GdkFrameClock *clock,
+    gpointer user_data)
 {
-    gtk_container_remove (
-        GTK_CONTAINER (list),
-        GTK_WIDGET (item)
-    );
-    gtk_widget_destroy (GTK_WIDGET (item));
+    TASK_PROBE_SCOPE ("task-list.c: on_animation_tick");
+    TaskListPrivate *priv = TASK_LIST (widget)->priv;
+    GHashTableIter iter;
+    gpointer window, item;
+    gint64 now = gdk_frame_clock_get_frame_time (clock);
+
+    if (now - priv->wakeup_period_start >= G_USEC_PER_SEC) {
+        priv->wakeup_rate = priv->wakeups;
+        priv->wakeups = 0;
+        priv->wakeup_period_start = now;
+    }
+    priv->wakeups++;
+
+    g_hash_table_iter_init (&iter, priv->urgent_items);
+    while (g_hash_table_iter_next (&iter, &window, &item)) {
+        /* repaint once more after attention cleared to reset the icon */
+        gtk_widget_queue_draw (GTK_WIDGET (item));
+        if (!wnck_window_or_transient_needs_attention (window))
+            g_hash_table_iter_remove (&iter);
+    }
+    if (g_hash_table_size (priv->urgent_items) == 0) {
+        priv->animation_tick = 0;
+        priv->wakeups = priv->wakeup_rate = 0;
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void task_list_animate_item (TaskList *taskList,
+    WnckWindow *window,
+    GtkWidget *item)
+{
+    TaskListPrivate *priv = taskList->priv;
+    g_hash_table_insert (priv->urgent_items, window, item);
+    if (!priv->animation_tick) {
+        priv->wakeup_period_start = g_get_monotonic_time ();
+        priv->animation_tick = gtk_widget_add_tick_callback (
+            GTK_WIDGET (taskList), on_animation_tick, NULL, NULL);
+    }
+}
+
+static void task_list_set_item_visibility (TaskList *taskList, GtkWidget *item);
+
+static gboolean task_list_update_visibility (TaskList *taskList) {
+    TASK_PROBE_SCOPE ("visibility pass");
+    TaskListPrivate *priv = taskList->priv;
+    GHashTableIter iter;
+    gpointer item;
+    g_hash_table_iter_init (&iter, priv->all_dirty ? priv->items : priv->dirty_items);
+    if (priv->all_dirty) {
+        while (g_hash_table_iter_next (&iter, NULL, &item))
+            task_list_set_item_visibility (taskList, item);
+    } else {
+        while (g_hash_table_iter_next (&iter, &item, NULL))
+            task_list_set_item_visibility (taskList, item);
+    }
+    g_hash_table_remove_all (priv->dirty_items);
+    priv->all_dirty = FALSE;
+    priv->visibility_source = 0;
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Marks the visibility of item, or of all items if item is NULL, as out of
+ * date. All changes that arrive before the next layout are applied together
+ * in a single pass, so that the box is only laid out once.
+ */
+static void task_list_queue_visibility (TaskList *taskList, GtkWidget *item) {
+    TaskListPrivate *priv = taskList->priv;
+    if (item == NULL) {
+        priv->all_dirty = TRUE;
+    } else if (!priv->all_dirty) {
+        g_hash_table_add (priv->dirty_items, item);
+    }
+    if (!priv->visibility_source) {
+        /* run before GTK+ processes the queued resizes */
+        priv->visibility_source = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+            (GSourceFunc) task_list_update_visibility, taskList, NULL);
+    }
+}
+
+/**
+ * Sends the minimize hints of all visible items in one pass. The origin of the
+ * toplevel is queried once for the whole list and only the windows whose icon
+ * geometry actually changed are sent to the X server. Updating every item on
+ * its own used to cost two X requests per item and allocation.
+ */
+static gboolean task_list_update_icon_geometries (GtkWidget *widget,
+    GdkFrameClock *clock,
+    gpointer user_data)
+{
+    TASK_PROBE_SCOPE ("task-list.c: task_list_update_icon_geometries");
+    TaskListPrivate *priv = TASK_LIST (widget)->priv;
+    GtkWidget *toplevel = gtk_widget_get_toplevel (widget);
+    GHashTableIter iter;
+    gpointer window, item;
+    gint origin_x = 0, origin_y = 0;
+    guint n_items = 0, n_requests = 1;
+
+    priv->icon_geometry_tick = 0;
+    if (GDK_IS_WINDOW (gtk_widget_get_window (toplevel)))
+        gdk_window_get_origin (gtk_widget_get_window (toplevel), &origin_x, &origin_y);
+    g_hash_table_iter_init (&iter, priv->items);
+    while (g_hash_table_iter_next (&iter, &window, &item)) {
+        GdkRectangle geometry, *last;
+        if (!gtk_widget_get_visible (item) || !gtk_widget_get_mapped (item))
+            continue;
+        if (!gtk_widget_translate_coordinates (item, toplevel, 0, 0,
+                &geometry.x, &geometry.y))
+            continue;
+        n_items++;
+        geometry.x += origin_x;
+        geometry.y += origin_y;
+        geometry.width = gtk_widget_get_allocated_width (item);
+        geometry.height = gtk_widget_get_allocated_height (item);
+        last = g_hash_table_lookup (priv->icon_geometries, item);
+        if (last && gdk_rectangle_equal (last, &geometry))
+            continue;
+        if (!last) {
+            last = g_new (GdkRectangle, 1);
+            g_hash_table_insert (priv->icon_geometries, item, last);
+        }
+        *last = geometry;
+        wnck_window_set_icon_geometry (window, geometry.x, geometry.y,
+            geometry.width, geometry.height);
+        n_requests++;
+    }
+    /* each item used to query the origin and set its geometry */
+    if (2 * n_items > n_requests)
+        priv->icon_geometry_saved += 2 * n_items - n_requests;
+    return G_SOURCE_REMOVE;
+}
+
+static void on_task_list_size_allocate (GtkWidget *widget,
+    GtkAllocation *allocation,
+    TaskList *taskList)
+{
+    TASK_PROBE_SCOPE ("task-list.c: on_task_list_size_allocate");
+    if (taskList->priv->icon_geometry_tick == 0) {
+        taskList->priv->icon_geometry_tick = gtk_widget_add_tick_callback (widget,
+            task_list_update_icon_geometries, NULL, NULL);
+    }
+}
+
+/**
+ * Items are kept in buckets by the workspace of their window, so that a
+ * workspace switch only needs to look at the items of the old and the new
+ * workspace. Windows on all workspaces share the pinned bucket, which is never
+ * affected by a switch. On a virtual workspace there is one bucket per viewport
+ * and a window is in the bucket of every viewport that it intersects.
+ */
+#define PINNED_BUCKET 0
+#define NO_BUCKET -1
+#define MAX_VIEWPORTS 4096
+
+static gint task_list_bucket_key (WnckWorkspace *workspace, gint viewport) {
+    return 1 + wnck_workspace_get_number (workspace) * MAX_VIEWPORTS + viewport;
+}
+
+static gint task_list_get_active_bucket (TaskList *taskList) {
+    WnckScreen *screen = taskList->priv->screen;
+    WnckWorkspace *workspace = wnck_screen_get_active_workspace (screen);
+    if (workspace == NULL)
+        return NO_BUCKET;
+    if (!wnck_workspace_is_virtual (workspace))
+        return task_list_bucket_key (workspace, 0);
+    gint screen_width = wnck_screen_get_width (screen);
+    gint screen_height = wnck_screen_get_height (screen);
+    gint columns = MAX (1, wnck_workspace_get_width (workspace) / screen_width);
+    gint column = wnck_workspace_get_viewport_x (workspace) / screen_width;
+    gint row = wnck_workspace_get_viewport_y (workspace) / screen_height;
+    return task_list_bucket_key (workspace, row * columns + column);
+}
+
+static GSList *task_list_get_window_buckets (TaskList *taskList,
+    WnckWindow *window)
+{
+    WnckScreen *screen = taskList->priv->screen;
+    WnckWorkspace *workspace = wnck_window_get_workspace (window);
+    GSList *keys = NULL;
+    if (workspace == NULL || wnck_window_is_pinned (window))
+        return g_slist_prepend (keys, GINT_TO_POINTER (PINNED_BUCKET));
+    if (!wnck_workspace_is_virtual (workspace))
+        return g_slist_prepend (keys, GINT_TO_POINTER (task_list_bucket_key (workspace, 0)));
+
+    /* the window geometry is relative to the current viewport */
+    gint x, y, width, height, row, column;
+    gint screen_width = wnck_screen_get_width (screen);
+    gint screen_height = wnck_screen_get_height (screen);
+    gint columns = MAX (1, wnck_workspace_get_width (workspace) / screen_width);
+    gint rows = MAX (1, wnck_workspace_get_height (workspace) / screen_height);
+    wnck_window_get_geometry (window, &x, &y, &width, &height);
+    x += wnck_workspace_get_viewport_x (workspace);
+    y += wnck_workspace_get_viewport_y (workspace);
+    gint first_column = CLAMP (x / screen_width, 0, columns - 1);
+    gint last_column = CLAMP ((x + MAX (width, 1) - 1) / screen_width, 0, columns - 1);
+    gint first_row = CLAMP (y / screen_height, 0, rows - 1);
+    gint last_row = CLAMP ((y + MAX (height, 1) - 1) / screen_height, 0, rows - 1);
+    for (row = first_row; row <= last_row; row++) {
+        for (column = first_column; column <= last_column; column++) {
+            keys = g_slist_prepend (keys,
+                GINT_TO_POINTER (task_list_bucket_key (workspace, row * columns + column)));
+        }
+    }
+    return keys;
+}
+
+static void task_list_remove_from_buckets (TaskList *taskList, GtkWidget *item) {
+    TaskListPrivate *priv = taskList->priv;
+    GSList *keys = g_hash_table_lookup (priv->item_buckets, item);
+    GSList *l;
+    for (l = keys; l; l = l->next) {
+        GHashTable *bucket = g_hash_table_lookup (priv->buckets, l->data);
+        g_hash_table_remove (bucket, item);
+        if (g_hash_table_size (bucket) == 0)
+            g_hash_table_remove (priv->buckets, l->data);
+    }
+    g_slist_free (keys);
+    g_hash_table_remove (priv->item_buckets, item);
+}
+
+/**
+ * Puts the item into the buckets for the current position of its window.
+ * Returns TRUE if the buckets of the item changed.
+ */
+static gboolean task_list_update_buckets (TaskList *taskList,
+    WnckWindow *window,
+    GtkWidget *item)
+{
+    TaskListPrivate *priv = taskList->priv;
+    GSList *keys = task_list_get_window_buckets (taskList, window);
+    GSList *old_keys = g_hash_table_lookup (priv->item_buckets, item);
+    GSList *l, *o;
+    for (l = keys, o = old_keys; l && o; l = l->next, o = o->next) {
+        if (l->data != o->data)
+            break;
+    }
+    if (old_keys && !l && !o) {
+        g_slist_free (keys);
+        return FALSE;
+    }
+    task_list_remove_from_buckets (taskList, item);
+    for (l = keys; l; l = l->next) {
+        GHashTable *bucket = g_hash_table_lookup (priv->buckets, l->data);
+        if (!bucket) {
+            bucket = g_hash_table_new (g_direct_hash, g_direct_equal);
+            g_hash_table_insert (priv->buckets, l->data, bucket);
+        }
+        g_hash_table_add (bucket, item);
+    }
+    g_hash_table_insert (priv->item_buckets, item, keys);
+    return TRUE;
+}
+
+/**
+ * An item is in view if it is in the pinned bucket or in the bucket of the
+ * active workspace and viewport.
+ */
+static gboolean task_list_is_item_in_view (TaskList *taskList, GtkWidget *item) {
+    TaskListPrivate *priv = taskList->priv;
+    GSList *l;
+    if (priv->active_bucket == NO_BUCKET)
+        return FALSE;
+    for (l = g_hash_table_lookup (priv->item_buckets, item); l; l = l->next) {
+        gint key = GPOINTER_TO_INT (l->data);
+        if (key == PINNED_BUCKET || key == priv->active_bucket)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void task_list_set_item_visibility (TaskList *taskList, GtkWidget *item) {
+    task_item_set_visibility (TASK_ITEM (item), task_list_is_item_in_view (taskList, item));
+}
+
+static void task_list_queue_bucket_visibility (TaskList *taskList, gint key) {
+    GHashTable *bucket = g_hash_table_lookup (taskList->priv->buckets, GINT_TO_POINTER (key));
+    GHashTableIter iter;
+    gpointer item;
+    if (!bucket)
+        return;
+    g_hash_table_iter_init (&iter, bucket);
+    while (g_hash_table_iter_next (&iter, &item, NULL))
+        task_list_queue_visibility (taskList, item);
+}
+
+/**
+ * Called on workspace and viewport switches, only the items that leave or
+ * enter the view need to be updated.
+ */
+static void task_list_switch_active_bucket (TaskList *taskList) {
+    TaskListPrivate *priv = taskList->priv;
+    gint active_bucket = task_list_get_active_bucket (taskList);
+    if (active_bucket == priv->active_bucket)
+        return;
+    if (!window_picker_applet_get_show_all_windows (priv->windowPickerApplet)) {
+        if (priv->active_bucket == NO_BUCKET || active_bucket == NO_BUCKET) {
+            task_list_queue_visibility (taskList, NULL);
+        } else {
+            task_list_queue_bucket_visibility (taskList, priv->active_bucket);
+            task_list_queue_bucket_visibility (taskList, active_bucket);
+        }
+    }
+    priv->active_bucket = active_bucket;
+}
+
+/**
+ * Workspaces were added or removed, which can change the workspace numbers
+ * used for the bucket keys, so all buckets are rebuilt.
+ */
+static void task_list_rebuild_buckets (TaskList *taskList) {
+    TaskListPrivate *priv = taskList->priv;
+    GHashTableIter iter;
+    gpointer window, item, keys;
+    g_hash_table_remove_all (priv->buckets);
+    g_hash_table_iter_init (&iter, priv->item_buckets);
+    while (g_hash_table_iter_next (&iter, NULL, &keys))
+        g_slist_free (keys);
+    g_hash_table_remove_all (priv->item_buckets);
+    g_hash_table_iter_init (&iter, priv->items);
+    while (g_hash_table_iter_next (&iter, &window, &item))
+        task_list_update_buckets (taskList, window, item);
+    priv->active_bucket = task_list_get_active_bucket (taskList);
+    task_list_queue_visibility (taskList, NULL);
+}
+
+static void on_window_workspace_changed (WnckWindow *window,
+    TaskList *taskList)
+{
+    TASK_PROBE_SCOPE ("task-list.c: on_window_workspace_changed");
+    g_return_if_fail (TASK_IS_LIST (taskList));
+    GtkWidget *item = g_hash_table_lookup (taskList->priv->items, window);
+    if (item) {
+        task_list_update_buckets (taskList, window, item);
+        task_list_queue_visibility (taskList, item);
+    }
+}
+
+static void on_window_geometry_changed (WnckWindow *window,
+    TaskList *taskList)
+{
+    TASK_PROBE_SCOPE ("task-list.c: on_window_geometry_changed");
+    g_return_if_fail (TASK_IS_LIST (taskList));
+    WnckWorkspace *workspace = wnck_window_get_workspace (window);
+    if (workspace == NULL || !wnck_workspace_is_virtual (workspace))
+        return;
+    GtkWidget *item = g_hash_table_lookup (taskList->priv->items, window);
+    if (item && task_list_update_buckets (taskList, window, item))
+        task_list_queue_visibility (taskList, item);
+}
+
+static void on_window_icon_changed (WnckWindow *window,
+    TaskList *taskList)
+{
+    TASK_PROBE_SCOPE ("task-list.c: on_window_icon_changed");
+    g_return_if_fail (TASK_IS_LIST (taskList));
+    GtkWidget *item = g_hash_table_lookup (taskList->priv->items, window);
+    if (item)
+        task_item_icon_changed (TASK_ITEM (item));
+}
+
+static void on_show_all_windows_changed (WindowPickerApplet *windowPickerApplet,
+    GParamSpec *pspec,
+    TaskList *taskList)
+{
+    TASK_PROBE_SCOPE ("task-list.c: on_show_all_windows_changed");
+    task_list_queue_visibility (taskList, NULL);
+}
+
+static void on_icons_greyscale_changed (WindowPickerApplet *windowPickerApplet,
+    GParamSpec *pspec,
+    TaskList *taskList)
+{
+    TASK_PROBE_SCOPE ("task-list.c: on_icons_greyscale_changed");
+    if (!window_picker_applet_get_icons_greyscale (windowPickerApplet))
+        task_icon_cache_drop_greyscale ();
+    /* only the items that are shown are repainted */
+    gtk_widget_queue_draw (GTK_WIDGET (taskList));
+}
+
+static void on_window_state_changed (WnckWindow *window,
+    WnckWindowState changed_mask,
+    WnckWindowState new_state,
+    TaskList *taskList)
+{
+    TASK_PROBE_SCOPE ("task-list.c: on_window_state_changed");
+    g_return_if_fail (TASK_IS_LIST (taskList));
+    GtkWidget *item = g_hash_table_lookup (taskList->priv->items, window);
+    if (!item)
+        return;
+    if (changed_mask & WNCK_WINDOW_STATE_MINIMIZED) {
+        if (new_state & WNCK_WINDOW_STATE_MINIMIZED)
+            taskList->priv->n_unminimized--;
+        else
+            taskList->priv->n_unminimized++;
+    }
+    if (wnck_window_or_transient_needs_attention (window))
+        task_list_animate_item (taskList, window, item);
+    task_list_queue_visibility (taskList, item);
+}
+
+/**
+ * Windows are identified across restarts by their class and role, windows
+ * without a class are not remembered.
+ */
+static gchar *task_list_get_window_identity (WnckWindow *window) {
+    const gchar *class_name = wnck_window_get_class_group_name (window);
+    const gchar *role = wnck_window_get_role (window);
+    if (class_name == NULL || *class_name == '\0')
+        return NULL;
+    if (role && *role)
+        return g_strdup_printf ("%s/%s", class_name, role);
+    return g_strdup (class_name);
+}
+
+static void task_list_set_saved_order (TaskList *taskList, gchar **order) {
+    TaskListPrivate *priv = taskList->priv;
+    guint i;
+    g_hash_table_remove_all (priv->ranks);
+    g_strfreev (priv->saved_order);
+    priv->saved_order = order;
+    for (i = 0; order[i]; i++) {
+        if (!g_hash_table_contains (priv->ranks, order[i]))
+            g_hash_table_insert (priv->ranks, order[i], GINT_TO_POINTER (i));
+    }
+}
+
+static gint task_list_get_window_rank (TaskList *taskList, WnckWindow *window) {
+    TaskListPrivate *priv = taskList->priv;
+    gchar *identity = task_list_get_window_identity (window);
+    gpointer rank;
+    gboolean found = FALSE;
+    if (identity) {
+        found = g_hash_table_lookup_extended (priv->ranks, identity, NULL, &rank);
+        if (!found) {
+            /* fall back to the class if the role was not seen before */
+            found = g_hash_table_lookup_extended (priv->ranks,
+                wnck_window_get_class_group_name (window), NULL, &rank);
+        }
+        g_free (identity);
+    }
+    return found ? GPOINTER_TO_INT (rank) : NO_RANK;
+}
+
+static gint task_list_get_item_rank (TaskList *taskList, gconstpointer item) {
+    return GPOINTER_TO_INT (g_hash_table_lookup (taskList->priv->item_ranks, item));
+}
+
+/**
+ * Orders the items by rank, so a new item is inserted with a binary search
+ * right behind the items of the same rank. Windows that were not seen before
+ * have the highest rank and go to the end.
+ */
+static gint task_list_compare_ranks (gconstpointer a, gconstpointer b, gpointer data) {
+    TaskList *taskList = data;
+    gint rank_a = task_list_get_item_rank (taskList, a);
+    gint rank_b = task_list_get_item_rank (taskList, b);
+    if (rank_a != rank_b)
+        return rank_a < rank_b ? -1 : 1;
+    /* the new item is not in positions yet */
+    if (!g_hash_table_contains (taskList->priv->positions, a))
+        return 1;
+    if (!g_hash_table_contains (taskList->priv->positions, b))
+        return -1;
+    return 0;
+}
+
+/**
+ * Saves the current order of the applications, followed by the applications
+ * that are remembered but have no windows at the moment.
+ */
+static gboolean task_list_save_order (TaskList *taskList) {
+    TASK_PROBE_SCOPE ("task-list.c: task_list_save_order");
+    TaskListPrivate *priv = taskList->priv;
+    GPtrArray *order = g_ptr_array_new ();
+    GHashTable *seen = g_hash_table_new (g_str_hash, g_str_equal);
+    GSequenceIter *iter;
+    guint i;
+
+    priv->order_save_source = 0;
+    for (iter = g_sequence_get_begin_iter (priv->order);
+         !g_sequence_iter_is_end (iter) && order->len < ORDER_MAX_ENTRIES;
+         iter = g_sequence_iter_next (iter))
+    {
+        WnckWindow *window = task_item_get_window (g_sequence_get (iter));
+        gchar *identity = window ? task_list_get_window_identity (window) : NULL;
+        if (identity == NULL || g_hash_table_contains (seen, identity)) {
+            g_free (identity);
+            continue;
+        }
+        g_hash_table_add (seen, identity);
+        g_ptr_array_add (order, identity);
+    }
+    for (i = 0; priv->saved_order[i] && order->len < ORDER_MAX_ENTRIES; i++) {
+        if (!g_hash_table_contains (seen, priv->saved_order[i]))
+            g_ptr_array_add (order, g_strdup (priv->saved_order[i]));
+    }
+    g_ptr_array_add (order, NULL);
+    g_hash_table_destroy (seen);
+
+    task_list_set_saved_order (taskList, (gchar **) g_ptr_array_free (order, FALSE));
+    g_settings_set_strv (window_picker_applet_get_settings (priv->windowPickerApplet),
+        KEY_TASK_ORDER, (const gchar * const *) priv->saved_order);
+    /* windows of one application can be apart, the ranks must not decrease
+     * along the order so that it stays sorted */
+    gint rank = 0;
+    for (iter = g_sequence_get_begin_iter (priv->order);
+         !g_sequence_iter_is_end (iter);
+         iter = g_sequence_iter_next (iter))
+    {
+        gpointer item = g_sequence_get (iter);
+        WnckWindow *window = task_item_get_window (item);
+        gchar *identity = window ? task_list_get_window_identity (window) : NULL;
+        if (identity) {
+            rank = MAX (rank, task_list_get_window_rank (taskList, window));
+            g_free (identity);
+        }
+        g_hash_table_insert (priv->item_ranks, item, GINT_TO_POINTER (rank));
+    }
+    return G_SOURCE_REMOVE;
 }
 
 static void on_window_opened (WnckScreen *screen,
     WnckWindow *window,
     TaskList *taskList)
 {
+    TASK_PROBE_SCOPE ("task-list.c: on_window_opened");
     g_return_if_fail (taskList != NULL);
-    WnckWindowType type = wnck_window_get_window_type (window);
-    if (type == WNCK_WINDOW_DESKTOP
-        || type == WNCK_WINDOW_DOCK
-        || type == WNCK_WINDOW_SPLASHSCREEN
-        || type == WNCK_WINDOW_MENU)
-    {
+    if (g_hash_table_contains (taskList->priv->items, window))
+        return;
+    if (!task_cell_is_task_window (window))
         return;
-    }
 
     GtkWidget *item = task_item_new (taskList->priv->windowPickerApplet, window);
 
     if (item) {
-        //we add items dynamically to the end of the list
+        /* the item goes straight into the position the user gave it before,
+         * allocation and forall follow the order so box children never move */
+        gint rank = task_list_get_window_rank (taskList, window);
+        g_hash_table_insert (taskList->priv->item_ranks, item, GINT_TO_POINTER (rank));
         gtk_container_add(GTK_CONTAINER(taskList), item);
-        g_signal_connect (TASK_ITEM(item), "task-item-closed",
-                G_CALLBACK(on_task_item_closed), taskList);
+        GSequenceIter *iter = g_sequence_insert_sorted (taskList->priv->order, item,
+            task_list_compare_ranks, taskList);
+        g_hash_table_insert (taskList->priv->items, window, item);
+        g_hash_table_insert (taskList->priv->positions, item, iter);
+        g_signal_connect (window, "state-changed",
+            G_CALLBACK (on_window_state_changed), taskList);
+        g_signal_connect (window, "workspace-changed",
+            G_CALLBACK (on_window_workspace_changed), taskList);
+        g_signal_connect (window, "geometry-changed",
+            G_CALLBACK (on_window_geometry_changed), taskList);
+        g_signal_connect (window, "icon-changed",
+            G_CALLBACK (on_window_icon_changed), taskList);
+        task_list_update_buckets (taskList, window, item);
+        task_list_set_item_visibility (taskList, item);
+        if (!wnck_window_is_minimized (window))
+            taskList->priv->n_unminimized++;
+        if (wnck_window_or_transient_needs_attention (window))
+            task_list_animate_item (taskList, window, item);
     }
 }
 
+/**
+ * The screen signals below are connected once for the whole list. Each event
+ * is routed through the items index to the one or two affected items, instead
+ * of being delivered to every TaskItem.
+ */
+static void on_window_closed (WnckScreen *screen,
+    WnckWindow *window,
+    TaskList *taskList)
+{
+    g_return_if_fail (TASK_IS_LIST (taskList));
+    TASK_PROBE_SCOPE ("window close");
+    GtkWidget *item = g_hash_table_lookup (taskList->priv->items, window);
+    if (!item) {
+        g_queue_remove (taskList->priv->pending, window);
+        return;
+    }
+    g_signal_handlers_disconnect_by_data (window, taskList);
+    if (!wnck_window_is_minimized (window))
+        taskList->priv->n_unminimized--;
+    g_hash_table_remove (taskList->priv->urgent_items, window);
+    g_hash_table_remove (taskList->priv->dirty_items, item);
+    task_list_remove_from_buckets (taskList, item);
+    g_hash_table_remove (taskList->priv->item_ranks, item);
+    g_hash_table_remove (taskList->priv->icon_geometries, item);
+    if (taskList->priv->drag) {
+        if (taskList->priv->drag->source == TASK_ITEM (item))
+            taskList->priv->drag->source = NULL;
+        if (taskList->priv->drag->target == TASK_ITEM (item))
+            taskList->priv->drag->target = NULL;
+    }
+    g_hash_table_remove (taskList->priv->items, window);
+    g_sequence_remove (g_hash_table_lookup (taskList->priv->positions, item));
+    g_hash_table_remove (taskList->priv->positions, item);
+    gtk_widget_destroy (item);
+}
+
+static void on_active_window_changed (WnckScreen *screen,
+    WnckWindow *old_window,
+    TaskList *taskList)
+{
+    g_return_if_fail (TASK_IS_LIST (taskList));
+    TASK_PROBE_SCOPE ("focus change");
+    GtkWidget *old_item = NULL, *new_item;
+    WnckWindow *active_window = wnck_screen_get_active_window (screen);
+    if (old_window)
+        old_item = g_hash_table_lookup (taskList->priv->items, old_window);
+    new_item = active_window
+        ? g_hash_table_lookup (taskList->priv->items, active_window)
+        : NULL;
+    /* queue a draw to reflect which item is [no longer] the active window */
+    if (old_item)
+        gtk_widget_queue_draw (old_item);
+    if (new_item && new_item != old_item)
+        gtk_widget_queue_draw (new_item);
+}
+
+static void on_icon_theme_changed (GtkIconTheme *theme, TaskList *taskList) {
+    TASK_PROBE_SCOPE ("task-list.c: on_icon_theme_changed");
+    /* the icon cache has been cleared, the items reload their icons on draw */
+    gtk_widget_queue_draw (GTK_WIDGET (taskList));
+}
+
+static void on_active_workspace_changed (WnckScreen *screen,
+    WnckWorkspace *old_workspace,
+    TaskList *taskList)
+{
+    g_return_if_fail (TASK_IS_LIST (taskList));
+    TASK_PROBE_SCOPE ("workspace switch");
+    task_list_switch_active_bucket (taskList);
+}
+
+static void on_viewports_changed (WnckScreen *screen,
+    TaskList *taskList)
+{
+    g_return_if_fail (TASK_IS_LIST (taskList));
+    TASK_PROBE_SCOPE ("viewport switch");
+    task_list_switch_active_bucket (taskList);
+}
+
+static void on_workspaces_changed (WnckScreen *screen,
+    WnckWorkspace *workspace,
+    TaskList *taskList)
+{
+    TASK_PROBE_SCOPE ("task-list.c: on_workspaces_changed");
+    g_return_if_fail (TASK_IS_LIST (taskList));
+    task_list_rebuild_buckets (taskList);
+}
+
+static void task_list_drag_session_free (TaskDragSession *drag) {
+    if (drag == NULL)
+        return;
+    g_object_unref (drag->context);
+    g_slice_free (TaskDragSession, drag);
+}
+
 /* GObject stuff */
 static void task_list_finalize (GObject *object) {
-    TaskListPrivate *priv = TASK_LIST (object)->priv;
-    /* Remove the blink timer */
-    if (priv->timer) g_source_remove (priv->timer);
+    TaskList *taskList = TASK_LIST (object);
+    TaskListPrivate *priv = taskList->priv;
+    GHashTableIter iter;
+    gpointer window, keys;
+
+    task_debug_dump_stats ();
+    task_debug_write_trace ();
+    g_hash_table_destroy (priv->item_ranks);
+    g_hash_table_destroy (priv->ranks);
+    g_strfreev (priv->saved_order);
+    if (priv->populate_source)
+        g_source_remove (priv->populate_source);
+    if (priv->visibility_source)
+        g_source_remove (priv->visibility_source);
+    g_queue_free (priv->pending);
+    g_hash_table_destroy (priv->dirty_items);
+    g_hash_table_destroy (priv->icon_geometries);
+    task_list_drag_session_free (priv->drag);
+    g_hash_table_iter_init (&iter, priv->item_buckets);
+    while (g_hash_table_iter_next (&iter, NULL, &keys))
+        g_slist_free (keys);
+    g_hash_table_destroy (priv->item_buckets);
+    g_hash_table_destroy (priv->buckets);
+    g_signal_handlers_disconnect_by_data (priv->windowPickerApplet, taskList);
+    g_signal_handlers_disconnect_by_data (priv->screen, taskList);
+    g_signal_handlers_disconnect_by_data (gtk_icon_theme_get_default (), taskList);
+    g_hash_table_iter_init (&iter, priv->items);
+    while (g_hash_table_iter_next (&iter, &window, NULL))
+        g_signal_handlers_disconnect_by_data (window, taskList);
+    g_hash_table_destroy (priv->urgent_items);
+    g_hash_table_destroy (priv->positions);
+    g_sequence_free (priv->order);
+    g_hash_table_destroy (priv->items);
 
     G_OBJECT_CLASS (task_list_parent_class)->finalize (object);
 }
@@ -80,6 +800,7 @@ static void on_task_list_orient_changed(PanelApplet *applet,
                                         guint orient,
                                         GtkBox *box)
 {
+    TASK_PROBE_SCOPE ("task-list.c: on_task_list_orient_changed");
     g_return_if_fail(box);
     switch(orient) {
         case PANEL_APPLET_ORIENT_UP:
@@ -97,22 +818,408 @@ static void on_task_list_orient_changed(PanelApplet *applet,
     gtk_widget_queue_resize(GTK_WIDGET(box));
 }
 
+/* Overflow */
+
+static void task_list_measure (GtkWidget *widget,
+    GtkOrientation orientation,
+    gint *minimum,
+    gint *natural)
+{
+    if (orientation == GTK_ORIENTATION_HORIZONTAL) {
+        gtk_widget_get_preferred_width (widget, minimum, natural);
+    } else {
+        gtk_widget_get_preferred_height (widget, minimum, natural);
+    }
+}
+
+/**
+ * All items have the same size, so only the first visible item is measured.
+ * The minimum size is a single item followed by the overflow button.
+ */
+static void task_list_get_preferred_size (TaskList *list,
+    GtkOrientation orientation,
+    gint *minimum,
+    gint *natural)
+{
+    TaskListPrivate *priv = list->priv;
+    GSequenceIter *iter;
+    gint spacing = gtk_box_get_spacing (GTK_BOX (list));
+    gint item_size = 0, button_size = 0;
+    guint n_visible = 0;
+
+    for (iter = g_sequence_get_begin_iter (priv->order);
+         !g_sequence_iter_is_end (iter);
+         iter = g_sequence_iter_next (iter))
+    {
+        GtkWidget *item = g_sequence_get (iter);
+        if (!gtk_widget_get_visible (item))
+            continue;
+        if (n_visible++ == 0)
+            task_list_measure (item, orientation, NULL, &item_size);
+    }
+    *natural = n_visible * item_size + MAX ((gint) n_visible - 1, 0) * spacing;
+    if (n_visible > 1) {
+        task_list_measure (priv->overflow_button, orientation, NULL, &button_size);
+        *minimum = MIN (*natural, item_size + spacing + button_size);
+    } else {
+        *minimum = *natural;
+    }
+}
+
+static void task_list_get_preferred_width (GtkWidget *widget,
+    gint *minimum,
+    gint *natural)
+{
+    if (gtk_orientable_get_orientation (GTK_ORIENTABLE (widget)) == GTK_ORIENTATION_HORIZONTAL) {
+        task_list_get_preferred_size (TASK_LIST (widget), GTK_ORIENTATION_HORIZONTAL, minimum, natural);
+    } else {
+        GTK_WIDGET_CLASS (task_list_parent_class)->get_preferred_width (widget, minimum, natural);
+    }
+}
+
+static void task_list_get_preferred_height (GtkWidget *widget,
+    gint *minimum,
+    gint *natural)
+{
+    if (gtk_orientable_get_orientation (GTK_ORIENTABLE (widget)) == GTK_ORIENTATION_VERTICAL) {
+        task_list_get_preferred_size (TASK_LIST (widget), GTK_ORIENTATION_VERTICAL, minimum, natural);
+    } else {
+        GTK_WIDGET_CLASS (task_list_parent_class)->get_preferred_height (widget, minimum, natural);
+    }
+}
+
+static GtkSizeRequestMode task_list_get_request_mode (GtkWidget *widget) {
+    return GTK_SIZE_REQUEST_CONSTANT_SIZE;
+}
+
+static void task_list_allocate_child (GtkWidget *child,
+    GtkAllocation *allocation,
+    GtkOrientation orientation,
+    gint offset,
+    gint size)
+{
+    GtkAllocation child_allocation = *allocation;
+    if (orientation == GTK_ORIENTATION_HORIZONTAL) {
+        child_allocation.x += offset;
+        child_allocation.width = size;
+    } else {
+        child_allocation.y += offset;
+        child_allocation.height = size;
+    }
+    gtk_widget_size_allocate (child, &child_allocation);
+}
+
+/**
+ * Lays out the visible items in order until the available space is used up,
+ * the remaining items are neither allocated nor mapped and can be reached
+ * through the overflow button instead. This keeps layout and drawing
+ * proportional to the number of items that are actually shown.
+ */
+static void task_list_size_allocate (GtkWidget *widget,
+    GtkAllocation *allocation)
+{
+    TASK_PROBE_SCOPE ("task-list.c: task_list_size_allocate");
+    TaskListPrivate *priv = TASK_LIST (widget)->priv;
+    GtkOrientation orientation = gtk_orientable_get_orientation (GTK_ORIENTABLE (widget));
+    gint available = orientation == GTK_ORIENTATION_HORIZONTAL
+        ? allocation->width : allocation->height;
+    gint spacing = gtk_box_get_spacing (GTK_BOX (widget));
+    gint offset = 0, button_size = 0;
+    GArray *sizes = g_array_new (FALSE, FALSE, sizeof (gint));
+    GPtrArray *shown = g_ptr_array_new ();
+    GSequenceIter *iter;
+    guint i;
+
+    gtk_widget_set_allocation (widget, allocation);
+    priv->n_overflow = 0;
+    for (iter = g_sequence_get_begin_iter (priv->order);
+         !g_sequence_iter_is_end (iter);
+         iter = g_sequence_iter_next (iter))
+    {
+        GtkWidget *item = g_sequence_get (iter);
+        gint size;
+        if (!gtk_widget_get_visible (item))
+            continue;
+        if (priv->n_overflow == 0) {
+            task_list_measure (item, orientation, NULL, &size);
+            if (offset + size <= available) {
+                g_ptr_array_add (shown, item);
+                g_array_append_val (sizes, size);
+                offset += size + spacing;
+                continue;
+            }
+        }
+        gtk_widget_set_child_visible (item, FALSE);
+        priv->n_overflow++;
+    }
+    if (priv->n_overflow > 0) {
+        /* make room for the overflow button */
+        task_list_measure (priv->overflow_button, orientation, NULL, &button_size);
+        while (shown->len > 0 && offset + button_size > available) {
+            gint size = g_array_index (sizes, gint, shown->len - 1);
+            gtk_widget_set_child_visible (g_ptr_array_index (shown, shown->len - 1), FALSE);
+            g_ptr_array_set_size (shown, shown->len - 1);
+            g_array_set_size (sizes, sizes->len - 1);
+            offset -= size + spacing;
+            priv->n_overflow++;
+        }
+    }
+    offset = 0;
+    for (i = 0; i < shown->len; i++) {
+        GtkWidget *item = g_ptr_array_index (shown, i);
+        gint size = g_array_index (sizes, gint, i);
+        gtk_widget_set_child_visible (item, TRUE);
+        task_list_allocate_child (item, allocation, orientation, offset, size);
+        offset += size + spacing;
+    }
+    gtk_widget_set_child_visible (priv->overflow_button, priv->n_overflow > 0);
+    if (priv->n_overflow > 0) {
+        gchar *tooltip = g_strdup_printf (
+            ngettext ("%u more window", "%u more windows", priv->n_overflow),
+            priv->n_overflow);
+        gtk_widget_set_tooltip_text (priv->overflow_button, tooltip);
+        g_free (tooltip);
+        task_list_allocate_child (priv->overflow_button, allocation, orientation,
+            offset, MIN (button_size, MAX (available - offset, 0)));
+    }
+    g_ptr_array_free (shown, TRUE);
+    g_array_free (sizes, TRUE);
+}
+
+static void on_overflow_item_activate (GtkMenuItem *menuItem,
+    WnckWindow *window)
+{
+    TASK_PROBE_SCOPE ("task-list.c: on_overflow_item_activate");
+    WnckWorkspace *workspace = wnck_window_get_workspace (window);
+    guint32 time = gtk_get_current_event_time ();
+    if (WNCK_IS_WORKSPACE (workspace)
+        && workspace != wnck_screen_get_active_workspace (wnck_window_get_screen (window)))
+    {
+        wnck_workspace_activate (workspace, time);
+    }
+    wnck_window_activate (window, time);
+}
+
+/**
+ * The popup is only built when the overflow button is clicked, it lists the
+ * windows of all visible items that did not fit.
+ */
+static void on_overflow_clicked (GtkButton *button, TaskList *taskList) {
+    TASK_PROBE_SCOPE ("task-list.c: on_overflow_clicked");
+    TaskListPrivate *priv = taskList->priv;
+    GSequenceIter *iter;
+    if (priv->overflow_menu)
+        gtk_widget_destroy (priv->overflow_menu);
+    priv->overflow_menu = gtk_menu_new ();
+    g_object_add_weak_pointer (G_OBJECT (priv->overflow_menu), (gpointer *) &priv->overflow_menu);
+    gtk_menu_attach_to_widget (GTK_MENU (priv->overflow_menu), GTK_WIDGET (button), NULL);
+    for (iter = g_sequence_get_begin_iter (priv->order);
+         !g_sequence_iter_is_end (iter);
+         iter = g_sequence_iter_next (iter))
+    {
+        GtkWidget *item = g_sequence_get (iter);
+        if (!gtk_widget_get_visible (item) || gtk_widget_get_child_visible (item))
+            continue;
+        WnckWindow *window = task_item_get_window (TASK_ITEM (item));
+        GtkWidget *menuItem = gtk_menu_item_new_with_label (wnck_window_get_name (window));
+        g_signal_connect_object (menuItem, "activate",
+            G_CALLBACK (on_overflow_item_activate), window, 0);
+        gtk_menu_shell_append (GTK_MENU_SHELL (priv->overflow_menu), menuItem);
+    }
+    gtk_widget_show_all (priv->overflow_menu);
+    gtk_menu_popup (GTK_MENU (priv->overflow_menu), NULL, NULL, NULL, NULL,
+        0, gtk_get_current_event_time ());
+}
+
+/**
+ * Walks the items in the order they are shown instead of the order of the box
+ * children, so that the focus chain, the accessible children and everything
+ * else that uses gtk_container_get_children follows the layout, without
+ * moving box children on every reorder.
+ */
+static void task_list_forall (GtkContainer *container,
+    gboolean include_internals,
+    GtkCallback callback,
+    gpointer callback_data)
+{
+    TaskListPrivate *priv = TASK_LIST (container)->priv;
+    GSequenceIter *iter = g_sequence_get_begin_iter (priv->order);
+    while (!g_sequence_iter_is_end (iter)) {
+        GtkWidget *item = g_sequence_get (iter);
+        /* the callback may remove the item, for example when destroying */
+        iter = g_sequence_iter_next (iter);
+        callback (item, callback_data);
+    }
+    if (include_internals && priv->overflow_button)
+        callback (priv->overflow_button, callback_data);
+}
+
+static void task_list_remove (GtkContainer *container, GtkWidget *child) {
+    TaskListPrivate *priv = TASK_LIST (container)->priv;
+    GSequenceIter *iter;
+    if (child == priv->overflow_button) {
+        gtk_widget_unparent (child);
+        priv->overflow_button = NULL;
+        return;
+    }
+    /* items that are removed without their window closing, when the list is
+     * destroyed, must leave the order that forall walks */
+    iter = g_hash_table_lookup (priv->positions, child);
+    if (iter) {
+        g_sequence_remove (iter);
+        g_hash_table_remove (priv->positions, child);
+    }
+    GTK_CONTAINER_CLASS (task_list_parent_class)->remove (container, child);
+}
+
+/**
+ * Children are only drawn where they intersect the damaged region, so with
+ * stats enabled the number of task_list_draw calls compared to the number of
+ * task_item_draw calls shows how many items each frame repaints.
+ */
+static gboolean task_list_draw (GtkWidget *widget, cairo_t *cr) {
+    TASK_PROBE_SCOPE ("task-list.c: task_list_draw");
+    return GTK_WIDGET_CLASS (task_list_parent_class)->draw (widget, cr);
+}
+
+static void task_list_destroy (GtkWidget *widget) {
+    TaskList *taskList = TASK_LIST (widget);
+    TaskListPrivate *priv = taskList->priv;
+    /* the items are still alive here, they are destroyed when chaining up */
+    if (priv->order_save_source) {
+        g_source_remove (priv->order_save_source);
+        task_list_save_order (taskList);
+    }
+    task_icon_cache_flush ();
+    if (priv->populate_source) {
+        g_source_remove (priv->populate_source);
+        priv->populate_source = 0;
+    }
+    if (priv->visibility_source) {
+        g_source_remove (priv->visibility_source);
+        priv->visibility_source = 0;
+    }
+    if (priv->overflow_button) {
+        gtk_widget_unparent (priv->overflow_button);
+        priv->overflow_button = NULL;
+    }
+    GTK_WIDGET_CLASS (task_list_parent_class)->destroy (widget);
+}
+
 static void
 task_list_class_init(TaskListClass *class) {
     GObjectClass *obj_class = G_OBJECT_CLASS (class);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (class);
+    GtkContainerClass *container_class = GTK_CONTAINER_CLASS (class);
 
     obj_class->finalize = task_list_finalize;
+    widget_class->destroy = task_list_destroy;
+    widget_class->get_request_mode = task_list_get_request_mode;
+    widget_class->get_preferred_width = task_list_get_preferred_width;
+    widget_class->get_preferred_height = task_list_get_preferred_height;
+    widget_class->size_allocate = task_list_size_allocate;
+    widget_class->draw = task_list_draw;
+    container_class->forall = task_list_forall;
+    container_class->remove = task_list_remove;
 }
 
 static void task_list_init (TaskList *list) {
     list->priv = task_list_get_instance_private (list);
     list->priv->screen = wnck_screen_get_default ();
-    /* No blink timer */
-    list->priv->timer = 0;
+    list->priv->items = g_hash_table_new (g_direct_hash, g_direct_equal);
+    list->priv->order = g_sequence_new (NULL);
+    list->priv->positions = g_hash_table_new (g_direct_hash, g_direct_equal);
+    list->priv->saved_order = NULL;
+    list->priv->ranks = g_hash_table_new (g_str_hash, g_str_equal);
+    list->priv->item_ranks = g_hash_table_new (g_direct_hash, g_direct_equal);
+    list->priv->order_save_source = 0;
+    list->priv->urgent_items = g_hash_table_new (g_direct_hash, g_direct_equal);
+    list->priv->n_unminimized = 0;
+    list->priv->pending = g_queue_new ();
+    list->priv->populate_source = 0;
+    list->priv->buckets = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+        NULL, (GDestroyNotify) g_hash_table_destroy);
+    list->priv->item_buckets = g_hash_table_new (g_direct_hash, g_direct_equal);
+    list->priv->active_bucket = NO_BUCKET;
+    list->priv->dirty_items = g_hash_table_new (g_direct_hash, g_direct_equal);
+    list->priv->all_dirty = FALSE;
+    list->priv->visibility_source = 0;
+    list->priv->icon_geometries = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+        NULL, g_free);
+    list->priv->icon_geometry_tick = 0;
+    list->priv->icon_geometry_saved = 0;
+    list->priv->drag = NULL;
+    list->priv->overflow_menu = NULL;
+    list->priv->n_overflow = 0;
+    list->priv->overflow_button = gtk_button_new_with_label ("»");
+    gtk_button_set_relief (GTK_BUTTON (list->priv->overflow_button), GTK_RELIEF_NONE);
+    gtk_widget_set_parent (list->priv->overflow_button, GTK_WIDGET (list));
+    gtk_widget_set_child_visible (list->priv->overflow_button, FALSE);
+    gtk_widget_show (list->priv->overflow_button);
+    g_signal_connect (list->priv->overflow_button, "clicked",
+            G_CALLBACK (on_overflow_clicked), list);
+    /* No urgency animation */
+    list->priv->animation_tick = 0;
     gtk_container_set_border_width (GTK_CONTAINER (list), 0);
 }
 
+static gboolean on_first_draw (GtkWidget *widget,
+    cairo_t *cr,
+    TaskList *taskList)
+{
+    task_probe_end (&first_paint_probe, taskList->priv->startup_time);
+    g_signal_handlers_disconnect_by_func (widget, on_first_draw, taskList);
+    return FALSE;
+}
+
+static gboolean task_list_populate_batch (TaskList *taskList) {
+    TASK_PROBE_SCOPE ("task-list.c: task_list_populate_batch");
+    TaskListPrivate *priv = taskList->priv;
+    guint i;
+    for (i = 0; i < POPULATE_BATCH_SIZE && !g_queue_is_empty (priv->pending); i++) {
+        on_window_opened (priv->screen, g_queue_pop_head (priv->pending), taskList);
+    }
+    if (!g_queue_is_empty (priv->pending))
+        return G_SOURCE_CONTINUE;
+    task_probe_end (&startup_probe, priv->startup_time);
+    priv->populate_source = 0;
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Creates the items for the windows of the active workspace right away, so
+ * they are shown on the first paint. The items for all other windows are
+ * created afterwards in small batches from a low priority idle callback.
+ */
+static void task_list_populate (TaskList *taskList) {
+    TaskListPrivate *priv = taskList->priv;
+    WnckWorkspace *workspace = wnck_screen_get_active_workspace (priv->screen);
+    GList *windows = wnck_screen_get_windows (priv->screen);
+
+    /* both startup probes are measured from startup_time */
+    priv->active_bucket = task_list_get_active_bucket (taskList);
+    priv->startup_time = task_probe_begin (&startup_probe);
+    task_probe_begin (&first_paint_probe);
+    g_signal_connect (taskList, "draw", G_CALLBACK (on_first_draw), taskList);
+
+    for (; windows != NULL; windows = windows->next) {
+        WnckWindow *window = windows->data;
+        if (workspace == NULL || wnck_window_is_on_workspace (window, workspace)) {
+            on_window_opened (priv->screen, window, taskList);
+        } else {
+            g_queue_push_tail (priv->pending, window);
+        }
+    }
+    if (g_queue_is_empty (priv->pending)) {
+        task_probe_end (&startup_probe, priv->startup_time);
+    } else {
+        priv->populate_source = g_idle_add_full (G_PRIORITY_LOW,
+            (GSourceFunc) task_list_populate_batch, taskList, NULL);
+    }
+}
+
 GtkWidget *task_list_new (WindowPickerApplet *windowPickerApplet) {
+    TASK_PROBE_SCOPE ("task-list.c: task_list_new");
     PanelAppletOrient panel_orientation = panel_applet_get_orient(PANEL_APPLET(windowPickerApplet));
     GtkOrientation orientation;
     switch(panel_orientation) {
@@ -134,34 +1241,222 @@ GtkWidget *task_list_new (WindowPickerApplet *windowPickerApplet) {
     );
 
     taskList->priv->windowPickerApplet = windowPickerApplet;
+    task_list_set_saved_order (taskList, g_settings_get_strv (
+        window_picker_applet_get_settings (windowPickerApplet), KEY_TASK_ORDER));
 
     g_signal_connect(PANEL_APPLET(windowPickerApplet), "change-orient",
                      G_CALLBACK(on_task_list_orient_changed), taskList);
+    g_signal_connect (windowPickerApplet, "notify::show-all-windows",
+            G_CALLBACK (on_show_all_windows_changed), taskList);
+    g_signal_connect (windowPickerApplet, "notify::icons-greyscale",
+            G_CALLBACK (on_icons_greyscale_changed), taskList);
     g_signal_connect (taskList->priv->screen, "window-opened",
             G_CALLBACK (on_window_opened), taskList);
+    g_signal_connect (taskList->priv->screen, "window-closed",
+            G_CALLBACK (on_window_closed), taskList);
+    g_signal_connect (taskList->priv->screen, "active-window-changed",
+            G_CALLBACK (on_active_window_changed), taskList);
+    g_signal_connect (taskList->priv->screen, "active-workspace-changed",
+            G_CALLBACK (on_active_workspace_changed), taskList);
+    g_signal_connect (taskList->priv->screen, "viewports-changed",
+            G_CALLBACK (on_viewports_changed), taskList);
+    g_signal_connect (taskList->priv->screen, "workspace-created",
+            G_CALLBACK (on_workspaces_changed), taskList);
+    g_signal_connect (taskList->priv->screen, "workspace-destroyed",
+            G_CALLBACK (on_workspaces_changed), taskList);
+    g_signal_connect (gtk_icon_theme_get_default (), "changed",
+            G_CALLBACK (on_icon_theme_changed), taskList);
+    g_signal_connect (taskList, "size-allocate",
+            G_CALLBACK (on_task_list_size_allocate), taskList);
 
-    GList *windows = wnck_screen_get_windows (taskList->priv->screen);
-    while (windows != NULL) {
-        on_window_opened (taskList->priv->screen, windows->data, taskList);
-        windows = windows->next;
-    }
+    task_list_populate (taskList);
     return (GtkWidget *) taskList;
 }
 
+/**
+ * Counts the windows of the screen that belong in the task list and are not
+ * minimized, this is only used to verify the counter.
+ */
+static guint task_list_count_unminimized (TaskList *list) {
+    GList *windows;
+    guint count = 0;
+    for (windows = wnck_screen_get_windows (list->priv->screen); windows; windows = windows->next) {
+        if (task_cell_is_task_window (windows->data) && !wnck_window_is_minimized (windows->data))
+            count++;
+    }
+    return count;
+}
+
+/**
+ * Windows that wait for their item during the startup population are not in
+ * n_unminimized yet, the queue is empty once the population finished.
+ */
+static guint task_list_count_pending_unminimized (TaskList *list) {
+    GList *l;
+    guint count = 0;
+    for (l = list->priv->pending->head; l; l = l->next) {
+        if (task_cell_is_task_window (l->data) && !wnck_window_is_minimized (l->data))
+            count++;
+    }
+    return count;
+}
+
+/**
+ * The desktop is visible if all windows of the task list are minimized. The
+ * answer comes from a counter that is updated on window open, close and state
+ * changes, with WINDOW_PICKER_DEBUG=check it is verified with a full scan of
+ * the windows of the screen.
+ */
 gboolean task_list_get_desktop_visible (TaskList *list) {
-    GList *windows, *w;
-    gboolean all_minimised = TRUE;
     g_return_val_if_fail (TASK_IS_LIST (list), TRUE);
-    windows = wnck_screen_get_windows (list->priv->screen);
-    for (w = windows; w; w = w->next) {
-        WnckWindow *window = w->data;
-        if (WNCK_IS_WINDOW (window) &&
-            !wnck_window_is_minimized (window) &&
-            !wnck_window_get_window_type (window) !=
-                WNCK_WINDOW_DESKTOP)
+    guint n_unminimized = list->priv->n_unminimized
+        + task_list_count_pending_unminimized (list);
+    if (task_debug_enabled (TASK_DEBUG_CHECK)) {
+        guint count = task_list_count_unminimized (list);
+        if (count != n_unminimized) {
+            g_warning ("Unminimized window count is %u, but a full scan found %u",
+                n_unminimized, count);
+        }
+    }
+    return n_unminimized == 0;
+}
+
+/**
+ * Returns how often the urgency animation woke up the applet during the last
+ * second, this is zero whenever no window needs attention.
+ */
+guint task_list_get_animation_wakeups (TaskList *list) {
+    g_return_val_if_fail (TASK_IS_LIST (list), 0);
+    return list->priv->animation_tick ? list->priv->wakeup_rate : 0;
+}
+
+/**
+ * Returns the number of X requests that were saved by batching the minimize
+ * hint updates of the items.
+ */
+guint64 task_list_get_icon_geometry_saved (TaskList *list) {
+    g_return_val_if_fail (TASK_IS_LIST (list), 0);
+    return list->priv->icon_geometry_saved;
+}
+
+/**
+ * Prints the memory, handlers and timers of every item and of the task list to
+ * stderr, so growth over long sessions can be attributed. This is triggered
+ * by sending SIGUSR1 with WINDOW_PICKER_DEBUG=memory.
+ */
+void task_list_dump_memory (TaskList *list) {
+    TaskListPrivate *priv = list->priv;
+    GSequenceIter *iter;
+    gsize icon_total = 0;
+    guint n_icons;
+    guint timers;
+
+    g_printerr ("%-10s %-32s %10s %9s %7s %5s\n",
+        "xid", "window", "icon bytes", "handlers", "timers", "menu");
+    for (iter = g_sequence_get_begin_iter (priv->order);
+         !g_sequence_iter_is_end (iter);
+         iter = g_sequence_iter_next (iter))
+    {
+        icon_total += task_item_dump_memory (g_sequence_get (iter));
+    }
+    timers = (priv->animation_tick != 0) + (priv->visibility_source != 0)
+        + (priv->icon_geometry_tick != 0) + (priv->populate_source != 0)
+        + (priv->order_save_source != 0);
+    g_printerr ("items: %u, pending windows: %u, overflow menu: %s\n",
+        g_hash_table_size (priv->items), g_queue_get_length (priv->pending),
+        priv->overflow_menu ? "created" : "-");
+    g_printerr ("icon bytes of all items (shared icons counted per item): %" G_GSIZE_FORMAT "\n",
+        icon_total);
+    g_printerr ("icon cache: %" G_GSIZE_FORMAT " bytes in %u icons\n",
+        task_icon_cache_get_memory_size (&n_icons), n_icons);
+    g_printerr ("handlers on the screen: %u, task list timers: %u\n",
+        task_debug_count_handlers (priv->screen), timers);
+}
+
+/**
+ * Moves item to the position of target, like a drag and drop reorder does:
+ * the item ends up after target if it was in front of it, and before target
+ * otherwise.
+ */
+void task_list_move_item (TaskList *list, TaskItem *item, TaskItem *target) {
+    g_return_if_fail (TASK_IS_LIST (list));
+    TASK_PROBE_SCOPE ("drag and drop reorder");
+    TaskListPrivate *priv = list->priv;
+    GSequenceIter *item_iter = g_hash_table_lookup (priv->positions, item);
+    GSequenceIter *target_iter = g_hash_table_lookup (priv->positions, target);
+    g_return_if_fail (item_iter != NULL && target_iter != NULL);
+    if (item_iter == target_iter)
+        return;
+    if (g_sequence_iter_compare (item_iter, target_iter) < 0) {
+        g_sequence_move (item_iter, g_sequence_iter_next (target_iter));
+    } else {
+        g_sequence_move (item_iter, target_iter);
+    }
+    /* the item takes the rank of its new neighbour to keep order sorted */
+    GSequenceIter *neighbour = g_sequence_iter_is_begin (item_iter)
+        ? g_sequence_iter_next (item_iter)
+        : g_sequence_iter_prev (item_iter);
+    g_hash_table_insert (priv->item_ranks, item, GINT_TO_POINTER (
+        task_list_get_item_rank (list, g_sequence_get (neighbour))));
+    gtk_widget_queue_resize (GTK_WIDGET (list));
+    if (priv->order_save_source == 0) {
+        priv->order_save_source = g_timeout_add_seconds (ORDER_SAVE_DELAY,
+            (GSourceFunc) task_list_save_order, list);
+    }
+}
+
+/**
+ * Called for every motion of a drag over one of the items. If the drag started
+ * on one of our items, the dragged item is moved to the target the first time
+ * the drag crosses it, motion within the same item is ignored. Returns TRUE if
+ * the drag comes from another client, such a drag only activates the window of
+ * the item it hovers.
+ */
+gboolean task_list_drag_motion (TaskList *list,
+    TaskItem *target,
+    GdkDragContext *context)
+{
+    g_return_val_if_fail (TASK_IS_LIST (list), FALSE);
+    TaskListPrivate *priv = list->priv;
+    TaskDragSession *drag = priv->drag;
+    if (drag == NULL || drag->context != context) {
+        GtkWidget *source = gtk_drag_get_source_widget (context);
+        if (source == NULL || !IS_TASK_ITEM (source)
+            || !g_hash_table_contains (priv->positions, source))
         {
-            all_minimised = FALSE;
+            return TRUE;
         }
+        task_list_drag_session_free (drag);
+        drag = priv->drag = g_slice_new0 (TaskDragSession);
+        drag->context = g_object_ref (context);
+        drag->source = TASK_ITEM (source);
+        drag->start = g_get_monotonic_time ();
+        drag->x_requests = task_debug_get_x_requests ();
+    }
+    if (target == drag->target || drag->source == NULL)
+        return FALSE;
+    drag->target = target;
+    if (drag->source != target) {
+        task_list_move_item (list, drag->source, target);
+        drag->reorders++;
+    }
+    return FALSE;
+}
+
+void task_list_drag_end (TaskList *list, GdkDragContext *context) {
+    g_return_if_fail (TASK_IS_LIST (list));
+    TaskListPrivate *priv = list->priv;
+    if (priv->drag == NULL || priv->drag->context != context)
+        return;
+    if (task_debug_enabled (TASK_DEBUG_STATS)) {
+        gdouble seconds = MAX (g_get_monotonic_time () - priv->drag->start, 1)
+            / (gdouble) G_USEC_PER_SEC;
+        guint64 x_requests = task_debug_get_x_requests () - priv->drag->x_requests;
+        g_printerr ("drag: %u reorders (%.1f/s), %" G_GUINT64_FORMAT
+            " X requests (%.1f/s) in %.2fs\n",
+            priv->drag->reorders, priv->drag->reorders / seconds,
+            x_requests, x_requests / seconds, seconds);
     }
-    return all_minimised;
+    task_list_drag_session_free (priv->drag);
+    priv->drag = NULL;
 }
@@ -21,6 +21,7 @@
 #define _TASK_LIST_H_
 
 #include "applet.h"
+#include "task-item.h"
 
 #include <glib.h>
 #include <gtk/gtk.h>
@@ -58,5 +59,11 @@ struct _TaskListClass {
 GType task_list_get_type (void) G_GNUC_CONST;
 GtkWidget * task_list_new (WindowPickerApplet* windowPickerApplet);
 gboolean    task_list_get_desktop_visible (TaskList *list);
+guint       task_list_get_animation_wakeups (TaskList *list);
+guint64     task_list_get_icon_geometry_saved (TaskList *list);
+void        task_list_dump_memory (TaskList *list);
+void        task_list_move_item (TaskList *list, TaskItem *item, TaskItem *target);
+gboolean    task_list_drag_motion (TaskList *list, TaskItem *target, GdkDragContext *context);
+void        task_list_drag_end (TaskList *list, GdkDragContext *context);
 
 #endif /* _TASK_LIST_H_ */
@@ -0,0 +1,1239 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#include "task-strip.h"
+#include "task-cell.h"
+#include "task-icon-cache.h"
+#include "task-debug.h"
+
+#include <time.h>
+#include <glib/gi18n.h>
+#include <libwnck/libwnck.h>
+#include <panel-applet.h>
+
+/**
+ * Everything the strip keeps for one window. The position of the window in
+ * the strip is the index of its entry in the entries array.
+ */
+typedef struct {
+    WnckWindow   *window;
+    TaskIcon     *icon;
+    gint64       urgent_time; /* frame time at which the urgency animation started */
+    GdkRectangle geometry; /* the last icon geometry sent for the window */
+    gint         slot; /* the cell the window is drawn in, or NO_SLOT */
+    gboolean     visible;
+} TaskStripEntry;
+
+struct _TaskStripPrivate {
+    WnckScreen *screen;
+    GArray *entries; /* one TaskStripEntry per window, in the order in which they are shown */
+    GHashTable *indexes; /* maps each WnckWindow to the index of its entry */
+    GArray *slots; /* the index of the entry drawn in each cell */
+    guint n_visible; /* number of entries whose window is shown on this workspace */
+    guint n_unminimized; /* number of windows in entries that are not minimized */
+    guint n_shown; /* number of windows that get a cell */
+    gint cell_size; /* size of each cell along the orientation */
+    gboolean overflow; /* the cell after the last slot is the overflow button */
+    GtkOrientation orientation;
+    GdkWindow *event_window;
+    GHashTable *urgent; /* the windows that need attention */
+    guint animation_tick;
+    guint icon_geometry_tick;
+    WnckWindow *hover; /* the window under the pointer */
+    gboolean hover_overflow;
+    WnckWindow *pressed; /* the window of the last button press, it is the one dragged */
+    gboolean drag_active; /* one of the windows is dragged */
+    WnckWindow *drag_target; /* the window a drag was last seen over */
+    guint activate_source; /* activates drag_target while a foreign drag hovers it */
+    GtkWidget *action_menu; /* the window menu while it is shown */
+    GtkWidget *overflow_menu;
+    WindowPickerApplet *windowPickerApplet;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (TaskStrip, task_strip, GTK_TYPE_WIDGET);
+
+#define NO_SLOT -1
+
+static TaskProbe startup_probe = { "startup population", 0, 0, 0, FALSE };
+
+static TaskStripEntry *task_strip_get_entry (TaskStrip *strip, guint index) {
+    return &g_array_index (strip->priv->entries, TaskStripEntry, index);
+}
+
+/* Returns the entry of window, the pointer is valid until entries changes */
+static TaskStripEntry *task_strip_lookup (TaskStrip *strip, WnckWindow *window) {
+    gpointer index;
+    if (window == NULL
+        || !g_hash_table_lookup_extended (strip->priv->indexes, window, NULL, &index))
+    {
+        return NULL;
+    }
+    return task_strip_get_entry (strip, GPOINTER_TO_UINT (index));
+}
+
+/* Updates the indexes of the entries from first to last */
+static void task_strip_reindex (TaskStrip *strip, guint first, guint last) {
+    TaskStripPrivate *priv = strip->priv;
+    guint i;
+    for (i = first; i <= last && i < priv->entries->len; i++) {
+        g_hash_table_insert (priv->indexes, task_strip_get_entry (strip, i)->window,
+            GUINT_TO_POINTER (i));
+    }
+}
+
+/* Returns the area of the cell at slot, relative to the allocation */
+static void task_strip_get_cell_area (TaskStrip *strip, gint slot, GdkRectangle *area) {
+    TaskStripPrivate *priv = strip->priv;
+    GtkAllocation allocation;
+    gtk_widget_get_allocation (GTK_WIDGET (strip), &allocation);
+    if (priv->orientation == GTK_ORIENTATION_HORIZONTAL) {
+        area->x = slot * priv->cell_size;
+        area->y = 0;
+        area->width = priv->cell_size;
+        area->height = allocation.height;
+    } else {
+        area->x = 0;
+        area->y = slot * priv->cell_size;
+        area->width = allocation.width;
+        area->height = priv->cell_size;
+    }
+}
+
+/**
+ * Returns the slot of the cell at x, y. The overflow button has the slot after
+ * the last window, NO_SLOT is returned if there is no cell.
+ */
+static gint task_strip_get_slot_at (TaskStrip *strip, gint x, gint y) {
+    TaskStripPrivate *priv = strip->priv;
+    gint offset = priv->orientation == GTK_ORIENTATION_HORIZONTAL ? x : y;
+    gint slot;
+    if (offset < 0 || priv->cell_size <= 0)
+        return NO_SLOT;
+    slot = offset / priv->cell_size;
+    if (slot < (gint) priv->slots->len || (slot == (gint) priv->slots->len && priv->overflow))
+        return slot;
+    return NO_SLOT;
+}
+
+/* Returns the window drawn at x, y or NULL */
+static WnckWindow *task_strip_get_window_at (TaskStrip *strip, gint x, gint y) {
+    gint slot = task_strip_get_slot_at (strip, x, y);
+    if (slot == NO_SLOT || slot >= (gint) strip->priv->slots->len)
+        return NULL;
+    return task_strip_get_entry (strip,
+        g_array_index (strip->priv->slots, guint, slot))->window;
+}
+
+/* Repaints only the cell of window, if it is drawn at all */
+static void task_strip_queue_draw_window (TaskStrip *strip, WnckWindow *window) {
+    TaskStripEntry *entry = task_strip_lookup (strip, window);
+    GdkRectangle area;
+    if (entry == NULL || entry->slot == NO_SLOT)
+        return;
+    task_strip_get_cell_area (strip, entry->slot, &area);
+    gtk_widget_queue_draw_area (GTK_WIDGET (strip), area.x, area.y, area.width, area.height);
+}
+
+static void task_strip_queue_draw_overflow (TaskStrip *strip) {
+    GdkRectangle area;
+    if (!strip->priv->overflow)
+        return;
+    task_strip_get_cell_area (strip, strip->priv->slots->len, &area);
+    gtk_widget_queue_draw_area (GTK_WIDGET (strip), area.x, area.y, area.width, area.height);
+}
+
+/**
+ * Gives the first n_shown visible windows a cell. This runs on allocation and
+ * whenever entries changed, so slots never refers to an entry that is gone.
+ */
+static void task_strip_assign_slots (TaskStrip *strip) {
+    TaskStripPrivate *priv = strip->priv;
+    guint i;
+    g_array_set_size (priv->slots, 0);
+    for (i = 0; i < priv->entries->len; i++) {
+        TaskStripEntry *entry = task_strip_get_entry (strip, i);
+        if (entry->visible && priv->slots->len < priv->n_shown) {
+            entry->slot = priv->slots->len;
+            g_array_append_val (priv->slots, i);
+        } else {
+            entry->slot = NO_SLOT;
+        }
+    }
+}
+
+/**
+ * Like the animation of the task list, a single frame clock callback repaints
+ * the cells of the windows that need attention while there are any.
+ */
+static gboolean on_animation_tick (GtkWidget *widget,
+    GdkFrameClock *clock,
+    gpointer user_data)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_animation_tick");
+    TaskStrip *strip = TASK_STRIP (widget);
+    GHashTableIter iter;
+    gpointer window;
+
+    g_hash_table_iter_init (&iter, strip->priv->urgent);
+    while (g_hash_table_iter_next (&iter, &window, NULL)) {
+        /* repaint once more after attention cleared to reset the icon */
+        task_strip_queue_draw_window (strip, window);
+        if (!wnck_window_or_transient_needs_attention (window))
+            g_hash_table_iter_remove (&iter);
+    }
+    if (g_hash_table_size (strip->priv->urgent) == 0) {
+        strip->priv->animation_tick = 0;
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void task_strip_animate_window (TaskStrip *strip, WnckWindow *window) {
+    TaskStripPrivate *priv = strip->priv;
+    g_hash_table_add (priv->urgent, window);
+    if (!priv->animation_tick) {
+        priv->animation_tick = gtk_widget_add_tick_callback (
+            GTK_WIDGET (strip), on_animation_tick, NULL, NULL);
+    }
+}
+
+/**
+ * The strip has no workspace buckets, so it asks libwnck whether the window
+ * is on the active workspace or in the active viewport.
+ */
+static gboolean task_strip_is_window_shown (TaskStrip *strip, WnckWindow *window) {
+    TaskStripPrivate *priv = strip->priv;
+    WnckWorkspace *workspace = wnck_screen_get_active_workspace (priv->screen);
+    gboolean in_view = FALSE;
+    if (workspace != NULL) {
+        in_view = wnck_workspace_is_virtual (workspace)
+            ? wnck_window_is_in_viewport (window, workspace)
+            : wnck_window_is_on_workspace (window, workspace);
+    }
+    return task_cell_is_window_shown (window, in_view,
+        window_picker_applet_get_show_all_windows (priv->windowPickerApplet));
+}
+
+/**
+ * Updates whether the windows are shown. The strip has no child widgets to
+ * show or hide, so the pass only flips a flag per window and lays the strip
+ * out once if any of them changed.
+ */
+static void task_strip_update_visibility (TaskStrip *strip) {
+    TASK_PROBE_SCOPE ("visibility pass");
+    TaskStripPrivate *priv = strip->priv;
+    gboolean changed = FALSE;
+    guint i;
+    for (i = 0; i < priv->entries->len; i++) {
+        TaskStripEntry *entry = task_strip_get_entry (strip, i);
+        gboolean visible = task_strip_is_window_shown (strip, entry->window);
+        if (visible != entry->visible) {
+            entry->visible = visible;
+            if (visible)
+                priv->n_visible++;
+            else
+                priv->n_visible--;
+            changed = TRUE;
+        }
+    }
+    if (changed)
+        gtk_widget_queue_resize (GTK_WIDGET (strip));
+}
+
+static void task_strip_update_window_visibility (TaskStrip *strip, WnckWindow *window) {
+    TaskStripEntry *entry = task_strip_lookup (strip, window);
+    gboolean visible;
+    if (entry == NULL)
+        return;
+    visible = task_strip_is_window_shown (strip, window);
+    if (visible == entry->visible)
+        return;
+    entry->visible = visible;
+    if (visible)
+        strip->priv->n_visible++;
+    else
+        strip->priv->n_visible--;
+    gtk_widget_queue_resize (GTK_WIDGET (strip));
+}
+
+/**
+ * Sends the minimize hints of all drawn windows in one pass, only for the
+ * windows whose cell moved since the last time.
+ */
+static gboolean task_strip_update_icon_geometries (GtkWidget *widget,
+    GdkFrameClock *clock,
+    gpointer user_data)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_update_icon_geometries");
+    TaskStrip *strip = TASK_STRIP (widget);
+    TaskStripPrivate *priv = strip->priv;
+    GtkWidget *toplevel = gtk_widget_get_toplevel (widget);
+    gint origin_x = 0, origin_y = 0;
+    guint i;
+
+    priv->icon_geometry_tick = 0;
+    if (!gtk_widget_get_mapped (widget))
+        return G_SOURCE_REMOVE;
+    if (GDK_IS_WINDOW (gtk_widget_get_window (toplevel)))
+        gdk_window_get_origin (gtk_widget_get_window (toplevel), &origin_x, &origin_y);
+    for (i = 0; i < priv->slots->len; i++) {
+        TaskStripEntry *entry = task_strip_get_entry (strip,
+            g_array_index (priv->slots, guint, i));
+        GdkRectangle geometry;
+        task_strip_get_cell_area (strip, i, &geometry);
+        if (!gtk_widget_translate_coordinates (widget, toplevel, geometry.x, geometry.y,
+                &geometry.x, &geometry.y))
+            continue;
+        geometry.x += origin_x;
+        geometry.y += origin_y;
+        if (gdk_rectangle_equal (&entry->geometry, &geometry))
+            continue;
+        entry->geometry = geometry;
+        wnck_window_set_icon_geometry (entry->window, geometry.x, geometry.y,
+            geometry.width, geometry.height);
+    }
+    return G_SOURCE_REMOVE;
+}
+
+static void task_strip_queue_icon_geometries (TaskStrip *strip) {
+    if (strip->priv->icon_geometry_tick == 0) {
+        strip->priv->icon_geometry_tick = gtk_widget_add_tick_callback (GTK_WIDGET (strip),
+            task_strip_update_icon_geometries, NULL, NULL);
+    }
+}
+
+static void on_window_workspace_changed (WnckWindow *window,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_window_workspace_changed");
+    task_strip_update_window_visibility (strip, window);
+}
+
+static void on_window_geometry_changed (WnckWindow *window,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_window_geometry_changed");
+    WnckWorkspace *workspace = wnck_window_get_workspace (window);
+    if (workspace == NULL || !wnck_workspace_is_virtual (workspace))
+        return;
+    task_strip_update_window_visibility (strip, window);
+}
+
+static void on_window_icon_changed (WnckWindow *window,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_window_icon_changed");
+    TaskStripEntry *entry = task_strip_lookup (strip, window);
+    if (entry == NULL)
+        return;
+    if (entry->icon) {
+        /* windows of the same application will pick up the new icon as well */
+        task_icon_cache_evict (entry->icon);
+        task_icon_unref (entry->icon);
+        entry->icon = NULL;
+    }
+    task_strip_queue_draw_window (strip, window);
+}
+
+static void on_window_state_changed (WnckWindow *window,
+    WnckWindowState changed_mask,
+    WnckWindowState new_state,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_window_state_changed");
+    if (!g_hash_table_contains (strip->priv->indexes, window))
+        return;
+    if (changed_mask & WNCK_WINDOW_STATE_MINIMIZED) {
+        if (new_state & WNCK_WINDOW_STATE_MINIMIZED)
+            strip->priv->n_unminimized--;
+        else
+            strip->priv->n_unminimized++;
+    }
+    if (wnck_window_or_transient_needs_attention (window))
+        task_strip_animate_window (strip, window);
+    task_strip_update_window_visibility (strip, window);
+}
+
+static void on_window_opened (WnckScreen *screen,
+    WnckWindow *window,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_window_opened");
+    TaskStripPrivate *priv = strip->priv;
+    TaskStripEntry entry = { 0, };
+    if (g_hash_table_contains (priv->indexes, window))
+        return;
+    if (!task_cell_is_task_window (window))
+        return;
+
+    entry.window = window;
+    entry.slot = NO_SLOT;
+    entry.visible = task_strip_is_window_shown (strip, window);
+    g_array_append_val (priv->entries, entry);
+    g_hash_table_insert (priv->indexes, window, GUINT_TO_POINTER (priv->entries->len - 1));
+    g_signal_connect (window, "state-changed",
+        G_CALLBACK (on_window_state_changed), strip);
+    g_signal_connect (window, "workspace-changed",
+        G_CALLBACK (on_window_workspace_changed), strip);
+    g_signal_connect (window, "geometry-changed",
+        G_CALLBACK (on_window_geometry_changed), strip);
+    g_signal_connect (window, "icon-changed",
+        G_CALLBACK (on_window_icon_changed), strip);
+    if (!wnck_window_is_minimized (window))
+        priv->n_unminimized++;
+    if (wnck_window_or_transient_needs_attention (window))
+        task_strip_animate_window (strip, window);
+    if (entry.visible) {
+        priv->n_visible++;
+        gtk_widget_queue_resize (GTK_WIDGET (strip));
+    }
+}
+
+static void on_window_closed (WnckScreen *screen,
+    WnckWindow *window,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("window close");
+    TaskStripPrivate *priv = strip->priv;
+    TaskStripEntry *entry = task_strip_lookup (strip, window);
+    guint index;
+    if (entry == NULL)
+        return;
+    index = GPOINTER_TO_UINT (g_hash_table_lookup (priv->indexes, window));
+    g_signal_handlers_disconnect_by_data (window, strip);
+    if (!wnck_window_is_minimized (window))
+        priv->n_unminimized--;
+    if (entry->visible) {
+        priv->n_visible--;
+        gtk_widget_queue_resize (GTK_WIDGET (strip));
+    }
+    if (entry->icon)
+        task_icon_unref (entry->icon);
+    g_hash_table_remove (priv->urgent, window);
+    if (priv->hover == window)
+        priv->hover = NULL;
+    if (priv->pressed == window)
+        priv->pressed = NULL;
+    if (priv->drag_target == window) {
+        priv->drag_target = NULL;
+        if (priv->activate_source) {
+            g_source_remove (priv->activate_source);
+            priv->activate_source = 0;
+        }
+    }
+    g_hash_table_remove (priv->indexes, window);
+    g_array_remove_index (priv->entries, index);
+    task_strip_reindex (strip, index, priv->entries->len - 1);
+    task_strip_assign_slots (strip);
+}
+
+static void on_active_window_changed (WnckScreen *screen,
+    WnckWindow *old_window,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("focus change");
+    WnckWindow *active_window = wnck_screen_get_active_window (screen);
+    /* only the cells of the old and the new active window are repainted */
+    task_strip_queue_draw_window (strip, old_window);
+    if (active_window != old_window)
+        task_strip_queue_draw_window (strip, active_window);
+}
+
+static void on_active_workspace_changed (WnckScreen *screen,
+    WnckWorkspace *old_workspace,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("workspace switch");
+    task_strip_update_visibility (strip);
+}
+
+static void on_viewports_changed (WnckScreen *screen,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("viewport switch");
+    task_strip_update_visibility (strip);
+}
+
+static void on_show_all_windows_changed (WindowPickerApplet *windowPickerApplet,
+    GParamSpec *pspec,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_show_all_windows_changed");
+    task_strip_update_visibility (strip);
+}
+
+static void on_icons_greyscale_changed (WindowPickerApplet *windowPickerApplet,
+    GParamSpec *pspec,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_icons_greyscale_changed");
+    if (!window_picker_applet_get_icons_greyscale (windowPickerApplet))
+        task_icon_cache_drop_greyscale ();
+    gtk_widget_queue_draw (GTK_WIDGET (strip));
+}
+
+static void on_icon_theme_changed (GtkIconTheme *theme, TaskStrip *strip) {
+    TASK_PROBE_SCOPE ("task-strip.c: on_icon_theme_changed");
+    /* the icon cache has been cleared, the icons are reloaded on draw */
+    gtk_widget_queue_draw (GTK_WIDGET (strip));
+}
+
+static GtkOrientation task_strip_get_orientation (PanelAppletOrient orient) {
+    switch (orient) {
+        case PANEL_APPLET_ORIENT_LEFT:
+        case PANEL_APPLET_ORIENT_RIGHT:
+            return GTK_ORIENTATION_VERTICAL;
+        default:
+            return GTK_ORIENTATION_HORIZONTAL;
+    }
+}
+
+static void on_task_strip_orient_changed (PanelApplet *applet,
+    guint orient,
+    TaskStrip *strip)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_task_strip_orient_changed");
+    strip->priv->orientation = task_strip_get_orientation (orient);
+    gtk_widget_queue_resize (GTK_WIDGET (strip));
+}
+
+/* Size and layout */
+
+static GtkSizeRequestMode task_strip_get_request_mode (GtkWidget *widget) {
+    return GTK_SIZE_REQUEST_CONSTANT_SIZE;
+}
+
+/**
+ * The strip asks for one cell per shown window, its minimum is a single cell
+ * followed by the overflow button.
+ */
+static void task_strip_get_preferred_size (TaskStrip *strip,
+    GtkOrientation orientation,
+    gint *minimum,
+    gint *natural)
+{
+    TaskStripPrivate *priv = strip->priv;
+    if (orientation != priv->orientation) {
+        *minimum = *natural = orientation == GTK_ORIENTATION_HORIZONTAL
+            ? DEFAULT_TASK_ITEM_WIDTH : DEFAULT_TASK_ITEM_HEIGHT;
+        return;
+    }
+    *natural = priv->n_visible * priv->cell_size;
+    *minimum = priv->n_visible > 1 ? 2 * priv->cell_size : *natural;
+}
+
+static void task_strip_get_preferred_width (GtkWidget *widget,
+    gint *minimum,
+    gint *natural)
+{
+    task_strip_get_preferred_size (TASK_STRIP (widget), GTK_ORIENTATION_HORIZONTAL,
+        minimum, natural);
+}
+
+static void task_strip_get_preferred_height (GtkWidget *widget,
+    gint *minimum,
+    gint *natural)
+{
+    task_strip_get_preferred_size (TASK_STRIP (widget), GTK_ORIENTATION_VERTICAL,
+        minimum, natural);
+}
+
+/**
+ * Assigns cells to the shown windows in order until the space is used up, the
+ * remaining windows are reached through the overflow button. Like a TaskItem a
+ * cell on a horizontal panel is six pixels wider than it is high.
+ */
+static void task_strip_size_allocate (GtkWidget *widget,
+    GtkAllocation *allocation)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_size_allocate");
+    TaskStrip *strip = TASK_STRIP (widget);
+    TaskStripPrivate *priv = strip->priv;
+    gint cell_size, available, n_fit;
+
+    gtk_widget_set_allocation (widget, allocation);
+    if (gtk_widget_get_realized (widget)) {
+        gdk_window_move_resize (priv->event_window, allocation->x, allocation->y,
+            allocation->width, allocation->height);
+    }
+    if (priv->orientation == GTK_ORIENTATION_HORIZONTAL) {
+        cell_size = MAX (DEFAULT_TASK_ITEM_WIDTH, allocation->height + 6);
+        available = allocation->width;
+    } else {
+        cell_size = DEFAULT_TASK_ITEM_HEIGHT;
+        available = allocation->height;
+    }
+    if (cell_size != priv->cell_size) {
+        priv->cell_size = cell_size;
+        gtk_widget_queue_resize (widget);
+    }
+    n_fit = available / cell_size;
+    priv->n_shown = priv->n_visible;
+    priv->overflow = FALSE;
+    if ((gint) priv->n_visible > n_fit) {
+        priv->n_shown = MAX (n_fit - 1, 0);
+        priv->overflow = n_fit > 0;
+    }
+    task_strip_assign_slots (strip);
+    task_strip_queue_icon_geometries (strip);
+    gtk_widget_queue_draw (widget);
+}
+
+static void task_strip_realize (GtkWidget *widget) {
+    TaskStripPrivate *priv = TASK_STRIP (widget)->priv;
+    GtkAllocation allocation;
+    GdkWindowAttr attributes;
+
+    gtk_widget_set_realized (widget, TRUE);
+    gtk_widget_get_allocation (widget, &allocation);
+    gtk_widget_set_window (widget, g_object_ref (gtk_widget_get_parent_window (widget)));
+    attributes.window_type = GDK_WINDOW_CHILD;
+    attributes.wclass = GDK_INPUT_ONLY;
+    attributes.x = allocation.x;
+    attributes.y = allocation.y;
+    attributes.width = allocation.width;
+    attributes.height = allocation.height;
+    attributes.event_mask = gtk_widget_get_events (widget)
+        | GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK
+        | GDK_ENTER_NOTIFY_MASK | GDK_LEAVE_NOTIFY_MASK | GDK_POINTER_MOTION_MASK;
+    priv->event_window = gdk_window_new (gtk_widget_get_parent_window (widget),
+        &attributes, GDK_WA_X | GDK_WA_Y);
+    gtk_widget_register_window (widget, priv->event_window);
+}
+
+static void task_strip_unrealize (GtkWidget *widget) {
+    TaskStripPrivate *priv = TASK_STRIP (widget)->priv;
+    gtk_widget_unregister_window (widget, priv->event_window);
+    gdk_window_destroy (priv->event_window);
+    priv->event_window = NULL;
+    GTK_WIDGET_CLASS (task_strip_parent_class)->unrealize (widget);
+}
+
+static void task_strip_map (GtkWidget *widget) {
+    GTK_WIDGET_CLASS (task_strip_parent_class)->map (widget);
+    gdk_window_show (TASK_STRIP (widget)->priv->event_window);
+}
+
+static void task_strip_unmap (GtkWidget *widget) {
+    gdk_window_hide (TASK_STRIP (widget)->priv->event_window);
+    GTK_WIDGET_CLASS (task_strip_parent_class)->unmap (widget);
+}
+
+/* Drawing */
+
+/**
+ * Returns the cached icon for the entry at the given size and the scale factor
+ * of the strip, like task_item_get_icon.
+ */
+static TaskIcon *task_strip_get_icon (TaskStrip *strip, TaskStripEntry *entry, gint size) {
+    gint scale = gtk_widget_get_scale_factor (GTK_WIDGET (strip));
+    if (entry->icon && (task_icon_is_stale (entry->icon)
+                        || task_icon_get_size (entry->icon) != size
+                        || task_icon_get_scale (entry->icon) != scale))
+    {
+        task_icon_unref (entry->icon);
+        entry->icon = NULL;
+    }
+    if (!entry->icon) {
+        entry->icon = task_icon_cache_lookup (entry->window, size, scale);
+    }
+    return entry->icon;
+}
+
+/* Draws the cell of one window with the same drawing as the TaskItems */
+static void task_strip_draw_entry (TaskStrip *strip,
+    TaskStripEntry *entry,
+    cairo_t *cr,
+    GdkRectangle *area,
+    gint64 now)
+{
+    TaskStripPrivate *priv = strip->priv;
+    gint size = MIN (area->height, area->width);
+    if (size <= 0)
+        return;
+    task_cell_draw (GTK_WIDGET (strip), cr, area, entry->window,
+        task_strip_get_icon (strip, entry, size),
+        priv->hover == entry->window,
+        window_picker_applet_get_icons_greyscale (priv->windowPickerApplet),
+        &entry->urgent_time, now);
+}
+
+static void task_strip_draw_overflow (TaskStrip *strip, cairo_t *cr, GdkRectangle *area) {
+    GtkWidget *widget = GTK_WIDGET (strip);
+    GtkStyleContext *context = gtk_widget_get_style_context (widget);
+    PangoLayout *layout = gtk_widget_create_pango_layout (widget, "»");
+    gint width, height;
+    if (strip->priv->hover_overflow) {
+        gtk_style_context_save (context);
+        gtk_style_context_set_state (context, GTK_STATE_FLAG_PRELIGHT);
+    }
+    pango_layout_get_pixel_size (layout, &width, &height);
+    gtk_render_layout (context, cr,
+        area->x + (area->width - width) / 2,
+        area->y + (area->height - height) / 2,
+        layout);
+    if (strip->priv->hover_overflow)
+        gtk_style_context_restore (context);
+    g_object_unref (layout);
+}
+
+/**
+ * All windows are drawn in a single pass, cells outside of the damaged region
+ * are skipped. With stats enabled the number of task_strip_draw calls can be
+ * compared with the task_list_draw and task_item_draw calls of the task list.
+ */
+static gboolean task_strip_draw (GtkWidget *widget, cairo_t *cr) {
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_draw");
+    TaskStrip *strip = TASK_STRIP (widget);
+    TaskStripPrivate *priv = strip->priv;
+    GdkFrameClock *clock = gtk_widget_get_frame_clock (widget);
+    gint64 now = clock ? gdk_frame_clock_get_frame_time (clock) : g_get_monotonic_time ();
+    GdkRectangle clip, area;
+    guint i;
+
+    if (!gdk_cairo_get_clip_rectangle (cr, &clip))
+        return FALSE;
+    for (i = 0; i < priv->slots->len; i++) {
+        task_strip_get_cell_area (strip, i, &area);
+        if (!gdk_rectangle_intersect (&area, &clip, NULL))
+            continue;
+        cairo_save (cr);
+        gdk_cairo_rectangle (cr, &area);
+        cairo_clip (cr);
+        task_strip_draw_entry (strip,
+            task_strip_get_entry (strip, g_array_index (priv->slots, guint, i)),
+            cr, &area, now);
+        cairo_restore (cr);
+    }
+    if (priv->overflow) {
+        task_strip_get_cell_area (strip, priv->slots->len, &area);
+        if (gdk_rectangle_intersect (&area, &clip, NULL))
+            task_strip_draw_overflow (strip, cr, &area);
+    }
+    return FALSE;
+}
+
+/* Input */
+
+static void task_strip_set_hover (TaskStrip *strip, WnckWindow *window, gboolean overflow) {
+    TaskStripPrivate *priv = strip->priv;
+    if (priv->hover != window) {
+        task_strip_queue_draw_window (strip, priv->hover);
+        priv->hover = window;
+        task_strip_queue_draw_window (strip, window);
+    }
+    if (priv->hover_overflow != overflow) {
+        priv->hover_overflow = overflow;
+        task_strip_queue_draw_overflow (strip);
+    }
+}
+
+static gboolean task_strip_motion_notify_event (GtkWidget *widget,
+    GdkEventMotion *event)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_motion_notify_event");
+    TaskStrip *strip = TASK_STRIP (widget);
+    gint slot = task_strip_get_slot_at (strip, event->x, event->y);
+    task_strip_set_hover (strip, task_strip_get_window_at (strip, event->x, event->y),
+        slot != NO_SLOT && slot == (gint) strip->priv->slots->len);
+    return FALSE;
+}
+
+static gboolean task_strip_leave_notify_event (GtkWidget *widget,
+    GdkEventCrossing *event)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_leave_notify_event");
+    task_strip_set_hover (TASK_STRIP (widget), NULL, FALSE);
+    return FALSE;
+}
+
+static gboolean destroy_action_menu (GtkWidget *menu) {
+    gtk_widget_destroy (menu);
+    return G_SOURCE_REMOVE;
+}
+
+/* See on_action_menu_deactivate in task-item.c */
+static void on_action_menu_deactivate (GtkWidget *menu, TaskStrip *strip) {
+    g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, (GSourceFunc) destroy_action_menu,
+        g_object_ref (menu), g_object_unref);
+}
+
+static void on_overflow_item_activate (GtkMenuItem *menuItem,
+    WnckWindow *window)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: on_overflow_item_activate");
+    WnckWorkspace *workspace = wnck_window_get_workspace (window);
+    guint32 time = gtk_get_current_event_time ();
+    if (WNCK_IS_WORKSPACE (workspace)
+        && workspace != wnck_screen_get_active_workspace (wnck_window_get_screen (window)))
+    {
+        wnck_workspace_activate (workspace, time);
+    }
+    wnck_window_activate (window, time);
+}
+
+/* Lists the shown windows that did not get a cell, like the task list does */
+static void task_strip_popup_overflow (TaskStrip *strip, GdkEventButton *event) {
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_popup_overflow");
+    TaskStripPrivate *priv = strip->priv;
+    guint i;
+    if (priv->overflow_menu)
+        gtk_widget_destroy (priv->overflow_menu);
+    priv->overflow_menu = gtk_menu_new ();
+    g_object_add_weak_pointer (G_OBJECT (priv->overflow_menu), (gpointer *) &priv->overflow_menu);
+    gtk_menu_attach_to_widget (GTK_MENU (priv->overflow_menu), GTK_WIDGET (strip), NULL);
+    for (i = 0; i < priv->entries->len; i++) {
+        TaskStripEntry *entry = task_strip_get_entry (strip, i);
+        if (!entry->visible || entry->slot != NO_SLOT)
+            continue;
+        GtkWidget *menuItem = gtk_menu_item_new_with_label (wnck_window_get_name (entry->window));
+        g_signal_connect_object (menuItem, "activate",
+            G_CALLBACK (on_overflow_item_activate), entry->window, 0);
+        gtk_menu_shell_append (GTK_MENU_SHELL (priv->overflow_menu), menuItem);
+    }
+    gtk_widget_show_all (priv->overflow_menu);
+    gtk_menu_popup (GTK_MENU (priv->overflow_menu), NULL, NULL, NULL, NULL,
+        event->button, event->time);
+}
+
+static gboolean task_strip_button_press_event (GtkWidget *widget,
+    GdkEventButton *event)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_button_press_event");
+    TaskStrip *strip = TASK_STRIP (widget);
+    TaskStripPrivate *priv = strip->priv;
+    WnckWindow *window = task_strip_get_window_at (strip, event->x, event->y);
+    priv->pressed = window;
+    if (window && event->button == 3) {
+        GtkWidget *menu = wnck_action_menu_new (window);
+        if (priv->action_menu)
+            gtk_widget_destroy (priv->action_menu);
+        priv->action_menu = menu;
+        g_object_add_weak_pointer (G_OBJECT (menu), (gpointer *) &priv->action_menu);
+        g_signal_connect (menu, "deactivate",
+            G_CALLBACK (on_action_menu_deactivate), strip);
+        gtk_menu_popup (
+            GTK_MENU (menu), NULL, NULL, NULL, NULL,
+            event->button, event->time
+        );
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static gboolean task_strip_button_release_event (GtkWidget *widget,
+    GdkEventButton *event)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_button_release_event");
+    TaskStrip *strip = TASK_STRIP (widget);
+    TaskStripPrivate *priv = strip->priv;
+    gint slot = task_strip_get_slot_at (strip, event->x, event->y);
+    WnckWindow *window;
+    WnckWorkspace *workspace;
+    /* If we are in a drag and drop action, then we are not activating
+     * the window which received a click
+     */
+    if (priv->drag_active || event->button != 1)
+        return TRUE;
+    if (slot != NO_SLOT && slot == (gint) priv->slots->len) {
+        task_strip_popup_overflow (strip, event);
+        return TRUE;
+    }
+    window = task_strip_get_window_at (strip, event->x, event->y);
+    if (window == NULL || window != priv->pressed)
+        return TRUE;
+    workspace = wnck_window_get_workspace (window);
+    if (WNCK_IS_WORKSPACE (workspace)
+        && workspace != wnck_screen_get_active_workspace (priv->screen))
+    {
+        wnck_workspace_activate (workspace, event->time);
+    }
+    if (wnck_window_is_active (window)) {
+        wnck_window_minimize (window);
+    } else {
+        wnck_window_activate (window, event->time);
+    }
+    return TRUE;
+}
+
+static gboolean task_strip_query_tooltip (GtkWidget *widget,
+    gint x, gint y,
+    gboolean keyboard_mode,
+    GtkTooltip *tooltip)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_query_tooltip");
+    TaskStrip *strip = TASK_STRIP (widget);
+    TaskStripPrivate *priv = strip->priv;
+    gint slot = task_strip_get_slot_at (strip, x, y);
+    GdkRectangle area;
+    if (slot == NO_SLOT)
+        return FALSE;
+    /* the tooltip is only moved and updated when the pointer leaves the cell */
+    task_strip_get_cell_area (strip, slot, &area);
+    gtk_tooltip_set_tip_area (tooltip, &area);
+    if (slot == (gint) priv->slots->len) {
+        guint n_overflow = priv->n_visible - priv->slots->len;
+        gchar *text = g_strdup_printf (
+            ngettext ("%u more window", "%u more windows", n_overflow), n_overflow);
+        gtk_tooltip_set_text (tooltip, text);
+        g_free (text);
+        return TRUE;
+    }
+    WnckWindow *window = task_strip_get_window_at (strip, x, y);
+    gtk_tooltip_set_text (tooltip, wnck_window_get_name (window));
+    gtk_tooltip_set_icon (tooltip, wnck_window_get_icon (window));
+    return TRUE;
+}
+
+/* Drag and drop code */
+
+static void task_strip_cancel_activate (TaskStrip *strip) {
+    if (strip->priv->activate_source) {
+        g_source_remove (strip->priv->activate_source);
+        strip->priv->activate_source = 0;
+    }
+}
+
+static gboolean activate_window (TaskStrip *strip) {
+    TASK_PROBE_SCOPE ("task-strip.c: activate_window");
+    TaskStripPrivate *priv = strip->priv;
+    priv->activate_source = 0;
+    if (WNCK_IS_WINDOW (priv->drag_target))
+        wnck_window_activate (priv->drag_target, time (NULL));
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Moves the entry of window to the position of target, like
+ * task_list_move_item: it ends up after target if it was in front of it, and
+ * before target otherwise.
+ */
+void task_strip_move_window (TaskStrip *strip, WnckWindow *window, WnckWindow *target) {
+    g_return_if_fail (TASK_IS_STRIP (strip));
+    TASK_PROBE_SCOPE ("drag reorder");
+    TaskStripPrivate *priv = strip->priv;
+    gpointer from_index, to_index;
+    if (window == target
+        || !g_hash_table_lookup_extended (priv->indexes, window, NULL, &from_index)
+        || !g_hash_table_lookup_extended (priv->indexes, target, NULL, &to_index))
+    {
+        return;
+    }
+    guint from = GPOINTER_TO_UINT (from_index), to = GPOINTER_TO_UINT (to_index);
+    TaskStripEntry entry = *task_strip_get_entry (strip, from);
+    g_array_remove_index (priv->entries, from);
+    g_array_insert_val (priv->entries, to, entry);
+    task_strip_reindex (strip, MIN (from, to), MAX (from, to));
+    task_strip_assign_slots (strip);
+    task_strip_queue_icon_geometries (strip);
+    gtk_widget_queue_draw (GTK_WIDGET (strip));
+}
+
+/**
+ * A drag of one of the windows reorders the strip as soon as it crosses into
+ * another cell. Drags from other clients (links, text) activate the window
+ * they hover for a second, their data is never needed for that.
+ */
+static gboolean task_strip_drag_motion (GtkWidget *widget,
+    GdkDragContext *context,
+    gint x,
+    gint y,
+    guint time)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_drag_motion");
+    TaskStrip *strip = TASK_STRIP (widget);
+    TaskStripPrivate *priv = strip->priv;
+    WnckWindow *target = task_strip_get_window_at (strip, x, y);
+    if (target == priv->drag_target)
+        return FALSE;
+    priv->drag_target = target;
+    task_strip_cancel_activate (strip);
+    if (target == NULL)
+        return FALSE;
+    if (gtk_drag_get_source_widget (context) == widget) {
+        if (priv->drag_active && priv->pressed && priv->pressed != target)
+            task_strip_move_window (strip, priv->pressed, target);
+    } else {
+        priv->activate_source = g_timeout_add (1000, (GSourceFunc) activate_window, strip);
+    }
+    return FALSE;
+}
+
+/* Emitted when a drag leaves the destination */
+static void task_strip_drag_leave (GtkWidget *widget,
+    GdkDragContext *context,
+    guint time)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_drag_leave");
+    task_strip_cancel_activate (TASK_STRIP (widget));
+    TASK_STRIP (widget)->priv->drag_target = NULL;
+}
+
+/**
+ * When the drag begin we first set the icon of the pressed window to appear
+ * next to the cursor
+ */
+static void task_strip_drag_begin (GtkWidget *widget, GdkDragContext *context) {
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_drag_begin");
+    TaskStripPrivate *priv = TASK_STRIP (widget)->priv;
+    gint size = MIN (priv->cell_size, priv->orientation == GTK_ORIENTATION_HORIZONTAL
+        ? gtk_widget_get_allocated_height (widget) : gtk_widget_get_allocated_width (widget));
+    if (priv->pressed && size > 0) {
+        /* the drag icon is set as a plain pixbuf, so it is looked up unscaled.
+         * It is set on the context, which holds it only until the drag ends */
+        TaskIcon *icon = task_icon_cache_lookup (priv->pressed, size, 1);
+        GdkPixbuf *pixbuf = task_icon_get_pixbuf (icon);
+        gtk_drag_set_icon_pixbuf (context, pixbuf,
+            gdk_pixbuf_get_width (pixbuf) / 2, gdk_pixbuf_get_height (pixbuf) / 2);
+        task_icon_unref (icon);
+    }
+    priv->drag_active = TRUE;
+}
+
+static void task_strip_drag_end (GtkWidget *widget,
+    GdkDragContext *drag_context)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_drag_end");
+    TaskStripPrivate *priv = TASK_STRIP (widget)->priv;
+    priv->drag_active = FALSE;
+    priv->drag_target = NULL;
+    priv->pressed = NULL;
+}
+
+/* Returning true here, causes the failed-animation not to be shown, see
+ * task_item_drag_failed */
+static gboolean task_strip_drag_failed (GtkWidget *widget,
+    GdkDragContext *context,
+    GtkDragResult result)
+{
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_drag_failed");
+    return TRUE;
+}
+
+/**
+ * Icons are cached per scale factor, when the strip moves to a monitor with a
+ * different scale the icons are loaded again on draw.
+ */
+static void task_strip_notify (GObject *object, GParamSpec *pspec) {
+    if (g_strcmp0 (g_param_spec_get_name (pspec), "scale-factor") == 0)
+        gtk_widget_queue_draw (GTK_WIDGET (object));
+    if (G_OBJECT_CLASS (task_strip_parent_class)->notify)
+        G_OBJECT_CLASS (task_strip_parent_class)->notify (object, pspec);
+}
+
+static void task_strip_destroy (GtkWidget *widget) {
+    TaskStrip *strip = TASK_STRIP (widget);
+    TaskStripPrivate *priv = strip->priv;
+    task_strip_cancel_activate (strip);
+    task_icon_cache_flush ();
+    if (priv->action_menu) {
+        g_signal_handlers_disconnect_by_func (priv->action_menu,
+            on_action_menu_deactivate, strip);
+        gtk_widget_destroy (priv->action_menu);
+    }
+    if (priv->overflow_menu)
+        gtk_widget_destroy (priv->overflow_menu);
+    GTK_WIDGET_CLASS (task_strip_parent_class)->destroy (widget);
+}
+
+static void task_strip_finalize (GObject *object) {
+    TaskStrip *strip = TASK_STRIP (object);
+    TaskStripPrivate *priv = strip->priv;
+    guint i;
+
+    task_debug_dump_stats ();
+    task_debug_write_trace ();
+    g_signal_handlers_disconnect_by_data (priv->windowPickerApplet, strip);
+    g_signal_handlers_disconnect_by_data (priv->screen, strip);
+    g_signal_handlers_disconnect_by_data (gtk_icon_theme_get_default (), strip);
+    for (i = 0; i < priv->entries->len; i++) {
+        TaskStripEntry *entry = task_strip_get_entry (strip, i);
+        g_signal_handlers_disconnect_by_data (entry->window, strip);
+        if (entry->icon)
+            task_icon_unref (entry->icon);
+    }
+    g_hash_table_destroy (priv->urgent);
+    g_hash_table_destroy (priv->indexes);
+    g_array_free (priv->slots, TRUE);
+    g_array_free (priv->entries, TRUE);
+
+    G_OBJECT_CLASS (task_strip_parent_class)->finalize (object);
+}
+
+static void task_strip_class_init (TaskStripClass *klass) {
+    GObjectClass *obj_class = G_OBJECT_CLASS (klass);
+    GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+    obj_class->finalize = task_strip_finalize;
+    obj_class->notify = task_strip_notify;
+    widget_class->destroy = task_strip_destroy;
+    widget_class->get_request_mode = task_strip_get_request_mode;
+    widget_class->get_preferred_width = task_strip_get_preferred_width;
+    widget_class->get_preferred_height = task_strip_get_preferred_height;
+    widget_class->size_allocate = task_strip_size_allocate;
+    widget_class->realize = task_strip_realize;
+    widget_class->unrealize = task_strip_unrealize;
+    widget_class->map = task_strip_map;
+    widget_class->unmap = task_strip_unmap;
+    widget_class->draw = task_strip_draw;
+    widget_class->motion_notify_event = task_strip_motion_notify_event;
+    widget_class->leave_notify_event = task_strip_leave_notify_event;
+    widget_class->button_press_event = task_strip_button_press_event;
+    widget_class->button_release_event = task_strip_button_release_event;
+    widget_class->query_tooltip = task_strip_query_tooltip;
+    widget_class->drag_motion = task_strip_drag_motion;
+    widget_class->drag_leave = task_strip_drag_leave;
+    widget_class->drag_begin = task_strip_drag_begin;
+    widget_class->drag_end = task_strip_drag_end;
+    widget_class->drag_failed = task_strip_drag_failed;
+}
+
+static void task_strip_init (TaskStrip *strip) {
+    TaskStripPrivate *priv = strip->priv = task_strip_get_instance_private (strip);
+    gtk_widget_set_has_window (GTK_WIDGET (strip), FALSE);
+    priv->screen = wnck_screen_get_default ();
+    priv->entries = g_array_new (FALSE, FALSE, sizeof (TaskStripEntry));
+    priv->indexes = g_hash_table_new (g_direct_hash, g_direct_equal);
+    priv->slots = g_array_new (FALSE, FALSE, sizeof (guint));
+    priv->n_visible = 0;
+    priv->n_unminimized = 0;
+    priv->n_shown = 0;
+    priv->cell_size = DEFAULT_TASK_ITEM_WIDTH;
+    priv->overflow = FALSE;
+    priv->orientation = GTK_ORIENTATION_HORIZONTAL;
+    priv->event_window = NULL;
+    priv->urgent = g_hash_table_new (g_direct_hash, g_direct_equal);
+    /* No urgency animation */
+    priv->animation_tick = 0;
+    priv->icon_geometry_tick = 0;
+    priv->hover = NULL;
+    priv->hover_overflow = FALSE;
+    priv->pressed = NULL;
+    priv->drag_active = FALSE;
+    priv->drag_target = NULL;
+    priv->activate_source = 0;
+    priv->action_menu = NULL;
+    priv->overflow_menu = NULL;
+}
+
+/**
+ * An entry is only a few words per window, so unlike the task list the strip
+ * sets up all windows right away instead of in idle batches.
+ */
+static void task_strip_populate (TaskStrip *strip) {
+    GList *windows = wnck_screen_get_windows (strip->priv->screen);
+    gint64 start = task_probe_begin (&startup_probe);
+    for (; windows != NULL; windows = windows->next)
+        on_window_opened (strip->priv->screen, windows->data, strip);
+    task_probe_end (&startup_probe, start);
+}
+
+GtkWidget *task_strip_new (WindowPickerApplet *windowPickerApplet) {
+    TASK_PROBE_SCOPE ("task-strip.c: task_strip_new");
+    TaskStrip *strip = g_object_new (TASK_TYPE_STRIP,
+                                     "has-tooltip", TRUE,
+                                     NULL
+    );
+    TaskStripPrivate *priv = strip->priv;
+
+    priv->windowPickerApplet = windowPickerApplet;
+    priv->orientation = task_strip_get_orientation (
+        panel_applet_get_orient (PANEL_APPLET (windowPickerApplet)));
+    if (priv->orientation == GTK_ORIENTATION_VERTICAL)
+        priv->cell_size = DEFAULT_TASK_ITEM_HEIGHT;
+
+    /* Like each TaskItem the strip is both the target and the source of a
+     * drag, the dragged window is the one last pressed */
+    task_cell_set_drag_targets (GTK_WIDGET (strip));
+
+    g_signal_connect (PANEL_APPLET (windowPickerApplet), "change-orient",
+            G_CALLBACK (on_task_strip_orient_changed), strip);
+    g_signal_connect (windowPickerApplet, "notify::show-all-windows",
+            G_CALLBACK (on_show_all_windows_changed), strip);
+    g_signal_connect (windowPickerApplet, "notify::icons-greyscale",
+            G_CALLBACK (on_icons_greyscale_changed), strip);
+    g_signal_connect (priv->screen, "window-opened",
+            G_CALLBACK (on_window_opened), strip);
+    g_signal_connect (priv->screen, "window-closed",
+            G_CALLBACK (on_window_closed), strip);
+    g_signal_connect (priv->screen, "active-window-changed",
+            G_CALLBACK (on_active_window_changed), strip);
+    g_signal_connect (priv->screen, "active-workspace-changed",
+            G_CALLBACK (on_active_workspace_changed), strip);
+    g_signal_connect (priv->screen, "viewports-changed",
+            G_CALLBACK (on_viewports_changed), strip);
+    g_signal_connect (gtk_icon_theme_get_default (), "changed",
+            G_CALLBACK (on_icon_theme_changed), strip);
+
+    task_strip_populate (strip);
+    return GTK_WIDGET (strip);
+}
+
+/**
+ * The desktop is visible if all windows of the strip are minimized, see
+ * task_list_get_desktop_visible.
+ */
+gboolean task_strip_get_desktop_visible (TaskStrip *strip) {
+    g_return_val_if_fail (TASK_IS_STRIP (strip), TRUE);
+    if (task_debug_enabled (TASK_DEBUG_CHECK)) {
+        GList *windows;
+        guint count = 0;
+        for (windows = wnck_screen_get_windows (strip->priv->screen); windows; windows = windows->next) {
+            if (task_cell_is_task_window (windows->data) && !wnck_window_is_minimized (windows->data))
+                count++;
+        }
+        if (count != strip->priv->n_unminimized) {
+            g_warning ("Unminimized window count is %u, but a full scan found %u",
+                strip->priv->n_unminimized, count);
+        }
+    }
+    return strip->priv->n_unminimized == 0;
+}
+
+/**
+ * Prints the memory, handlers and timers of the strip to stderr, like
+ * task_list_dump_memory. The per window cost is one entry and one index slot.
+ */
+void task_strip_dump_memory (TaskStrip *strip) {
+    TaskStripPrivate *priv = strip->priv;
+    guint n_icons;
+    guint timers = (priv->animation_tick != 0) + (priv->icon_geometry_tick != 0)
+        + (priv->activate_source != 0);
+    gsize entry_bytes = priv->entries->len * sizeof (TaskStripEntry)
+        + priv->slots->len * sizeof (guint);
+    guint i;
+
+    g_printerr ("%-10s %-32s %10s %9s\n", "xid", "window", "icon bytes", "handlers");
+    for (i = 0; i < priv->entries->len; i++) {
+        TaskStripEntry *entry = task_strip_get_entry (strip, i);
+        g_printerr ("%-10lu %-32.32s %10" G_GSIZE_FORMAT " %9u\n",
+            wnck_window_get_xid (entry->window),
+            wnck_window_get_name (entry->window),
+            entry->icon ? task_icon_get_memory_size (entry->icon) : 0,
+            task_debug_count_handlers (entry->window));
+    }
+    g_printerr ("windows: %u, shown: %u, entry bytes: %" G_GSIZE_FORMAT
+        " (%" G_GSIZE_FORMAT " per window), menus: %s %s\n",
+        priv->entries->len, priv->slots->len, entry_bytes, sizeof (TaskStripEntry),
+        priv->action_menu ? "window" : "-", priv->overflow_menu ? "overflow" : "-");
+    g_printerr ("icon cache: %" G_GSIZE_FORMAT " bytes in %u icons\n",
+        task_icon_cache_get_memory_size (&n_icons), n_icons);
+    g_printerr ("handlers on the screen: %u, task strip timers: %u\n",
+        task_debug_count_handlers (priv->screen), timers);
+}
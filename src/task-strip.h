@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2014 Sebastian Geiger
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Authored by Sebastian Geiger <sbastig@gmx.net>
+ */
+
+#ifndef _TASK_STRIP_H_
+#define _TASK_STRIP_H_
+
+#include "applet.h"
+
+#include <glib.h>
+#include <gtk/gtk.h>
+#include <libwnck/libwnck.h>
+
+#define TASK_TYPE_STRIP (task_strip_get_type ())
+
+#define TASK_STRIP(obj) (G_TYPE_CHECK_INSTANCE_CAST ((obj),\
+    TASK_TYPE_STRIP, TaskStrip))
+
+#define TASK_STRIP_CLASS(klass) (G_TYPE_CHECK_CLASS_CAST ((klass),\
+    TASK_TYPE_STRIP, TaskStripClass))
+
+#define TASK_IS_STRIP(obj) (G_TYPE_CHECK_INSTANCE_TYPE ((obj),\
+    TASK_TYPE_STRIP))
+
+#define TASK_IS_STRIP_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),\
+    TASK_TYPE_STRIP))
+
+#define TASK_STRIP_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj),\
+    TASK_TYPE_STRIP, TaskStripClass))
+
+typedef struct _TaskStrip        TaskStrip;
+typedef struct _TaskStripClass   TaskStripClass;
+typedef struct _TaskStripPrivate TaskStripPrivate;
+
+/**
+ * The TaskStrip is the single widget rendering mode of the task list. Instead
+ * of one TaskItem widget per window it keeps a small state record for every
+ * window and draws, hit-tests and drags all of them from one widget.
+ */
+struct _TaskStrip {
+    GtkWidget         parent;
+    TaskStripPrivate *priv;
+};
+
+struct _TaskStripClass {
+    GtkWidgetClass   parent_class;
+};
+
+GType task_strip_get_type (void) G_GNUC_CONST;
+GtkWidget * task_strip_new (WindowPickerApplet *windowPickerApplet);
+gboolean    task_strip_get_desktop_visible (TaskStrip *strip);
+void        task_strip_dump_memory (TaskStrip *strip);
+void        task_strip_move_window (TaskStrip *strip, WnckWindow *window, WnckWindow *target);
+
+#endif /* _TASK_STRIP_H_ */
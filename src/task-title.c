@@ -27,7 +27,7 @@
 #include <glib/gi18n-lib.h>
 
 #include "task-title.h"
-#include "task-list.h"
+#include "task-debug.h"
 
 struct _TaskTitlePrivate {
     WnckScreen *screen;
@@ -54,6 +54,7 @@ static gboolean on_close_clicked (GtkButton *button,
     GdkEventButton *event,
     TaskTitle *title)
 {
+    TASK_PROBE_SCOPE ("task-title.c: on_close_clicked");
     g_return_val_if_fail (TASK_IS_TITLE (title), FALSE);
     TaskTitlePrivate *priv = title->priv;
     if (event->button != 1 || !priv->mouse_in_close_button)
@@ -77,6 +78,7 @@ static gboolean on_enter_notify (GtkWidget *widget,
      GdkEventCrossing *event,
      TaskTitle *title)
 {
+    TASK_PROBE_SCOPE ("task-title.c: on_enter_notify");
     g_return_val_if_fail (TASK_IS_TITLE (title), FALSE);
     title->priv->mouse_in_close_button = TRUE;
     gtk_widget_set_state_flags(widget, GTK_STATE_PRELIGHT, FALSE);
@@ -88,6 +90,7 @@ static gboolean on_leave_notify (GtkWidget *widget,
         GdkEventCrossing *event,
         TaskTitle *title)
 {
+    TASK_PROBE_SCOPE ("task-title.c: on_leave_notify");
     g_return_val_if_fail (TASK_IS_TITLE (title), FALSE);
     title->priv->mouse_in_close_button = FALSE;
     gtk_widget_unset_state_flags(widget, GTK_STATE_PRELIGHT);
@@ -99,6 +102,7 @@ static gboolean on_button_draw (GtkWidget *widget,
                 cairo_t *cr,
                 gpointer userdata)
 {
+    TASK_PROBE_SCOPE ("task-title.c: on_button_draw");
     TaskTitle *title = (TaskTitle*) userdata;
     g_return_val_if_fail (TASK_IS_TITLE (title), FALSE);
     TaskTitlePrivate *priv = title->priv;
@@ -115,6 +119,7 @@ static gboolean on_button_draw (GtkWidget *widget,
 }
 
 static void on_name_changed (WnckWindow *window, TaskTitle *title) {
+    TASK_PROBE_SCOPE ("task-title.c: on_name_changed");
     g_return_if_fail (TASK_IS_TITLE (title));
     g_return_if_fail (WNCK_IS_WINDOW (window));
     gtk_label_set_text (GTK_LABEL (title->priv->label),
@@ -133,6 +138,7 @@ static void on_state_changed (WnckWindow *window,
         WnckWindowState new_state,
         TaskTitle *title)
 {
+    TASK_PROBE_SCOPE ("task-title.c: on_state_changed");
     TaskTitlePrivate *priv = title->priv;
     g_return_if_fail (TASK_IS_TITLE (title));
     g_return_if_fail (WNCK_IS_WINDOW (window));
@@ -190,6 +196,7 @@ on_active_window_changed (WnckScreen *screen,
                           WnckWindow *old_window,
                           TaskTitle  *title)
 {
+    TASK_PROBE_SCOPE ("task-title.c: on_active_window_changed");
     g_return_if_fail (TASK_IS_TITLE (title));
     WnckWindow *act_window = wnck_screen_get_active_window (screen);
     WnckWindowType type = WNCK_WINDOW_NORMAL;
@@ -241,7 +248,7 @@ on_active_window_changed (WnckScreen *screen,
             }
         }
     } else { //its not a window
-        if (task_list_get_desktop_visible (TASK_LIST (window_picker_applet_get_tasks (priv->windowPickerApplet)))
+        if (window_picker_applet_get_desktop_visible (priv->windowPickerApplet)
                 && window_picker_applet_get_show_home_title (priv->windowPickerApplet))
         {
             show_home_title(title);
@@ -253,12 +260,21 @@ on_active_window_changed (WnckScreen *screen,
     gtk_widget_queue_draw (GTK_WIDGET (title));
 }
 
+static void on_title_settings_changed (WindowPickerApplet *windowPickerApplet,
+    GParamSpec *pspec,
+    TaskTitle *title)
+{
+    TASK_PROBE_SCOPE ("task-title.c: on_title_settings_changed");
+    on_active_window_changed (title->priv->screen, NULL, title);
+}
+
 /**
  * Event handler for clicking on the title (not the close button)
  * On double click unmaximized the window
  * On right click it shows the context menu for the current window
  */
 static gboolean on_button_press (GtkWidget *title, GdkEventButton *event) {
+    TASK_PROBE_SCOPE ("task-title.c: on_button_press");
     g_return_val_if_fail (TASK_IS_TITLE (title), FALSE);
     TaskTitlePrivate *priv = TASK_TITLE (title)->priv;
     WnckWindow *window = wnck_screen_get_active_window (priv->screen);
@@ -289,6 +305,7 @@ static gboolean on_draw (
     cairo_t *cr,
     gpointer userdata)
 {
+    TASK_PROBE_SCOPE ("task-title.c: on_draw");
     if (gtk_widget_get_state_flags (widget) == GTK_STATE_FLAG_ACTIVE) {
         //window is either maximized or we are on the desktop
         GtkStyleContext *context = gtk_widget_get_style_context (widget);
@@ -410,6 +427,7 @@ task_title_finalize (GObject *object)
     TaskTitle *title = TASK_TITLE (object);
 
     disconnect_window (title);
+    g_signal_handlers_disconnect_by_data (title->priv->windowPickerApplet, title);
     g_object_unref (title->priv->quit_icon);
 
     G_OBJECT_CLASS (task_title_parent_class)->finalize (object);
@@ -456,6 +474,10 @@ task_title_new (WindowPickerApplet *windowPickerApplet)
                                    NULL);
 
     title->priv->windowPickerApplet = windowPickerApplet;
+    g_signal_connect (windowPickerApplet, "notify::show-application-title",
+        G_CALLBACK (on_title_settings_changed), title);
+    g_signal_connect (windowPickerApplet, "notify::show-home-title",
+        G_CALLBACK (on_title_settings_changed), title);
 
     if (window_picker_applet_get_show_home_title (title->priv->windowPickerApplet)) {
         gtk_widget_set_state_flags (GTK_WIDGET (title), GTK_STATE_FLAG_ACTIVE, TRUE);
@@ -465,3 +487,16 @@ task_title_new (WindowPickerApplet *windowPickerApplet)
 
     return GTK_WIDGET (title);
 }
+
+/**
+ * Prints the memory of the quit icon and the handlers of the title on the
+ * tracked window to stderr, see task_list_dump_memory.
+ */
+void
+task_title_dump_memory (TaskTitle *title)
+{
+    TaskTitlePrivate *priv = title->priv;
+    g_printerr ("title: quit icon %" G_GSIZE_FORMAT " bytes, handlers on the window: %u\n",
+        priv->quit_icon ? gdk_pixbuf_get_byte_length (priv->quit_icon) : 0,
+        priv->window ? task_debug_count_handlers (priv->window) : 0);
+}
@@ -48,5 +48,6 @@ struct _TaskTitleClass {
 
 GType task_title_get_type (void) G_GNUC_CONST;
 GtkWidget * task_title_new (WindowPickerApplet *windowPickerApplet);
+void        task_title_dump_memory (TaskTitle *title);
 
 #endif /* _TASK_TITLE_H_ */